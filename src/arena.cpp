@@ -0,0 +1,243 @@
+#include "arena.hpp"
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <stdexcept>
+
+namespace luma {
+
+offset_allocator::offset_allocator(uint32_t const& capacity) : m_capacity(capacity) {
+    reset();
+}
+
+auto offset_allocator::allocate(uint32_t const& size) -> uint32_t {
+    if (size == 0) return invalid;
+    auto it = m_by_size.lower_bound(size);
+    if (it == m_by_size.end()) return invalid;
+
+    auto const offset = it->second;
+    auto const block  = it->first;
+    erase_free(m_free.find(offset));
+    if (block > size) insert_free(offset + size, block - size);
+
+    m_allocated[offset] = size;
+    m_used += size;
+    return offset;
+}
+
+auto offset_allocator::free(uint32_t const& offset) -> void {
+    auto found = m_allocated.find(offset);
+    if (found == m_allocated.end()) return;
+    auto start = offset;
+    auto size  = found->second;
+    m_allocated.erase(found);
+    m_used -= size;
+
+    auto next = m_free.lower_bound(start);
+    if (next != m_free.end() && start + size == next->first) {
+        size += next->second;
+        next = std::next(next);
+        erase_free(std::prev(next));
+    }
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            size += prev->second;
+            erase_free(prev);
+        }
+    }
+    insert_free(start, size);
+}
+
+auto offset_allocator::grow(uint32_t const& capacity) -> void {
+    if (capacity <= m_capacity) return;
+    auto start = m_capacity;
+    auto size  = capacity - m_capacity;
+    m_capacity = capacity;
+    if (!m_free.empty()) {
+        auto last = std::prev(m_free.end());
+        if (last->first + last->second == start) {
+            start = last->first;
+            size += last->second;
+            erase_free(last);
+        }
+    }
+    insert_free(start, size);
+}
+
+auto offset_allocator::reset() -> void {
+    m_free.clear();
+    m_by_size.clear();
+    m_allocated.clear();
+    m_used = 0;
+    if (m_capacity > 0) insert_free(0, m_capacity);
+}
+
+auto offset_allocator::statistics() const -> stats {
+    return {
+        m_capacity,
+        m_used,
+        uint32_t(m_allocated.size()),
+        uint32_t(m_free.size()),
+        m_by_size.empty() ? 0 : m_by_size.rbegin()->first,
+    };
+}
+
+auto offset_allocator::insert_free(uint32_t const& offset, uint32_t const& size) -> void {
+    m_free[offset] = size;
+    m_by_size.insert({size, offset});
+}
+
+auto offset_allocator::erase_free(std::map<uint32_t, uint32_t>::iterator const& it) -> void {
+    auto [first, last] = m_by_size.equal_range(it->second);
+    for (; first != last; first++) {
+        if (first->second == it->first) {
+            m_by_size.erase(first);
+            break;
+        }
+    }
+    m_free.erase(it);
+}
+
+namespace buffer {
+
+arena::arena(buffer::layout const& layout, uint32_t const& vertex_capacity, uint32_t const& index_capacity)
+    : m_layout(layout), m_vertices(vertex_capacity), m_indices(index_capacity) {
+    resize(vertex_capacity, index_capacity, false);
+}
+
+auto arena::allocate(void const* vertices, uint32_t const& vertex_count, uint32_t const* indices,
+                     uint32_t const& index_count, mesh::topology const& topology) -> id {
+    auto vertex_offset = m_vertices.allocate(vertex_count);
+    if (vertex_offset == offset_allocator::invalid) {
+        auto capacity = std::max(m_vertices.capacity() * 2, m_vertices.capacity() + vertex_count);
+        resize(capacity, m_indices.capacity(), false);
+        vertex_offset = m_vertices.allocate(vertex_count);
+    }
+    auto index_offset = m_indices.allocate(index_count);
+    if (index_offset == offset_allocator::invalid) {
+        auto capacity = std::max(m_indices.capacity() * 2, m_indices.capacity() + index_count);
+        resize(m_vertices.capacity(), capacity, false);
+        index_offset = m_indices.allocate(index_count);
+    }
+    if (vertex_offset == offset_allocator::invalid || index_offset == offset_allocator::invalid) {
+        m_vertices.free(vertex_offset);
+        m_indices.free(index_offset);
+        throw std::runtime_error("Failed to allocate mesh in arena");
+    }
+
+    auto const stride = uint32_t(m_layout.get_stride());
+    m_vertex_buffer->update(vertex_offset * stride, vertices, vertex_count * stride);
+    m_index_buffer->update(index_offset, indices, index_count);
+
+    auto mesh = m_next_id++;
+    m_ranges[mesh] = {int32_t(vertex_offset), vertex_count, index_offset, index_count, topology};
+    return mesh;
+}
+
+auto arena::allocate(mesh::surface const& surface) -> id {
+    return allocate(surface.vertices().data(), surface.vertex_count(),
+                    surface.indices().data(), surface.index_count(), surface.topology());
+}
+
+auto arena::release(id const& mesh) -> void {
+    auto it = m_ranges.find(mesh);
+    if (it == m_ranges.end()) return;
+    m_vertices.free(uint32_t(it->second.base_vertex));
+    m_indices.free(it->second.first_index);
+    m_ranges.erase(it);
+}
+
+auto arena::bind() const -> void {
+    m_array->bind();
+}
+
+auto arena::draw(id const& mesh) const -> void {
+    auto const& range = get(mesh);
+    auto const is_strip = range.topology == mesh::topology::triangle_strip;
+    if (is_strip) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(mesh::restart_index);
+    }
+    glDrawElementsBaseVertex(is_strip ? GL_TRIANGLE_STRIP : GL_TRIANGLES, GLsizei(range.index_count),
+                             GL_UNSIGNED_INT, (void const*)(intptr_t)(range.first_index * sizeof(uint32_t)),
+                             range.base_vertex);
+    if (is_strip) glDisable(GL_PRIMITIVE_RESTART);
+}
+
+auto arena::defragment() -> void {
+    resize(m_vertices.capacity(), m_indices.capacity(), true);
+}
+
+auto arena::statistics() const -> stats {
+    return {m_vertices.statistics(), m_indices.statistics(), uint32_t(m_ranges.size())};
+}
+
+auto arena::create(buffer::layout const& layout, uint32_t const& vertex_capacity,
+                   uint32_t const& index_capacity) -> ref<arena> {
+    return make_ref<arena>(layout, vertex_capacity, index_capacity);
+}
+
+// Move every range into freshly created buffers on the GPU. When packing, the
+// ranges are laid out back to back in their current order, which closes all
+// holes left by released meshes.
+auto arena::resize(uint32_t const& vertex_capacity, uint32_t const& index_capacity, bool const& pack) -> void {
+    auto const stride = uint32_t(m_layout.get_stride());
+    glBindVertexArray(0);
+    auto vertex_buffer = vertex::create(nullptr, vertex_capacity * stride);
+    auto index_buffer  = index::create(nullptr, index_capacity);
+    vertex_buffer->set_layout(m_layout);
+
+    if (pack) {
+        m_vertices = offset_allocator{vertex_capacity};
+        m_indices  = offset_allocator{index_capacity};
+    } else {
+        m_vertices.grow(vertex_capacity);
+        m_indices.grow(index_capacity);
+    }
+
+    if (m_vertex_buffer) {
+        std::vector<range*> ranges;
+        ranges.reserve(m_ranges.size());
+        for (auto& [_, range] : m_ranges) ranges.push_back(&range);
+        std::sort(std::begin(ranges), std::end(ranges), [](range const* a, range const* b) {
+            return a->base_vertex < b->base_vertex;
+        });
+
+        auto copy = [](uint32_t const& from, uint32_t const& to,
+                       uint32_t const& read, uint32_t const& write, uint32_t const& size) {
+            glBindBuffer(GL_COPY_READ_BUFFER, from);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, read, write, size);
+        };
+        for (auto range : ranges) {
+            auto vertex_offset = uint32_t(range->base_vertex);
+            auto index_offset  = range->first_index;
+            if (pack) {
+                vertex_offset = m_vertices.allocate(range->vertex_count);
+                index_offset  = m_indices.allocate(range->index_count);
+            }
+            copy(m_vertex_buffer->get_id(), vertex_buffer->get_id(), uint32_t(range->base_vertex) * stride,
+                 vertex_offset * stride, range->vertex_count * stride);
+            copy(m_index_buffer->get_id(), index_buffer->get_id(), range->first_index * sizeof(uint32_t),
+                 index_offset * sizeof(uint32_t), range->index_count * sizeof(uint32_t));
+            range->base_vertex = int32_t(vertex_offset);
+            range->first_index = index_offset;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    m_vertex_buffer = vertex_buffer;
+    m_index_buffer  = index_buffer;
+    m_array         = array::create();
+    m_array->add_vertex_buffer(m_vertex_buffer);
+    m_array->set_index_buffer(m_index_buffer);
+}
+
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include "luma.hpp"
+#include "buffer.hpp"
+#include "mesh.hpp"
+
+namespace luma {
+
+// Best-fit allocator over the range [0, capacity). It only hands out offsets,
+// the memory itself lives elsewhere (e.g. inside a GL buffer). Free blocks are
+// coalesced with their neighbours on release.
+class offset_allocator {
+  public:
+    static constexpr uint32_t invalid = max::u32;
+
+    struct stats {
+        uint32_t capacity;
+        uint32_t used;
+        uint32_t allocations;
+        uint32_t free_blocks;
+        uint32_t largest_free;
+    };
+
+  public:
+    offset_allocator(uint32_t const& capacity = 0);
+    ~offset_allocator() = default;
+
+    auto allocate(uint32_t const& size) -> uint32_t;
+    auto free(uint32_t const& offset) -> void;
+    auto grow(uint32_t const& capacity) -> void;
+    auto reset() -> void;
+
+    auto capacity() const -> uint32_t { return m_capacity; }
+    auto statistics() const -> stats;
+
+  private:
+    auto insert_free(uint32_t const& offset, uint32_t const& size) -> void;
+    auto erase_free(std::map<uint32_t, uint32_t>::iterator const& it) -> void;
+
+  private:
+    uint32_t m_capacity;
+    uint32_t m_used = 0;
+    std::map<uint32_t, uint32_t>           m_free;     // offset -> size
+    std::multimap<uint32_t, uint32_t>      m_by_size;  // size   -> offset
+    std::unordered_map<uint32_t, uint32_t> m_allocated;
+};
+
+namespace buffer {
+
+// One large vertex and index buffer shared by every mesh with the same vertex
+// format. Meshes are drawn with glDrawElementsBaseVertex from one VAO, so
+// switching between them needs no rebinding at all.
+class arena {
+  public:
+    using id = uint32_t;
+
+    struct range {
+        int32_t        base_vertex;
+        uint32_t       vertex_count;
+        uint32_t       first_index;
+        uint32_t       index_count;
+        mesh::topology topology = mesh::topology::triangles;
+    };
+
+    struct stats {
+        offset_allocator::stats vertices;
+        offset_allocator::stats indices;
+        uint32_t meshes;
+    };
+
+  public:
+    arena(buffer::layout const& layout, uint32_t const& vertex_capacity = 1 << 16,
+          uint32_t const& index_capacity = 1 << 18);
+    ~arena() = default;
+
+    auto allocate(void const* vertices, uint32_t const& vertex_count, uint32_t const* indices,
+                  uint32_t const& index_count, mesh::topology const& topology = mesh::topology::triangles) -> id;
+    auto allocate(mesh::surface const& surface) -> id;
+    auto release(id const& mesh) -> void;
+    auto get(id const& mesh) const -> range const& { return m_ranges.at(mesh); }
+
+    auto bind() const -> void;
+    // Expects bind() to have been called. Strips are drawn with primitive
+    // restart on.
+    auto draw(id const& mesh) const -> void;
+
+    // Pack every mesh to the front of the buffers. Ids stay valid.
+    auto defragment() -> void;
+    auto statistics() const -> stats;
+
+    static auto create(buffer::layout const& layout, uint32_t const& vertex_capacity = 1 << 16,
+                       uint32_t const& index_capacity = 1 << 18) -> ref<arena>;
+
+  private:
+    auto resize(uint32_t const& vertex_capacity, uint32_t const& index_capacity, bool const& pack) -> void;
+
+  private:
+    buffer::layout     m_layout;
+    ref<vertex>        m_vertex_buffer;
+    ref<index>         m_index_buffer;
+    ref<array>         m_array;
+    offset_allocator   m_vertices;
+    offset_allocator   m_indices;
+    id                 m_next_id = 0;
+    std::unordered_map<id, range> m_ranges;
+};
+
+}
+
+}
@@ -0,0 +1,299 @@
+#include "atlas.hpp"
+#include "pixel.hpp"
+#include "profile.hpp"
+#include "resample.hpp"
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace luma {
+
+static auto overlaps(max_rects::rect const& a, max_rects::rect const& b) -> bool {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static auto contains(max_rects::rect const& outer, max_rects::rect const& inner) -> bool {
+    return inner.x >= outer.x && inner.y >= outer.y
+        && inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
+
+max_rects::max_rects(int32_t const& width, int32_t const& height) : m_width(width), m_height(height) {
+    clear();
+}
+
+auto max_rects::insert(int32_t const& width, int32_t const& height) -> std::optional<rect> {
+    std::optional<rect> best;
+    auto best_short = std::numeric_limits<int32_t>::max();
+    auto best_long  = std::numeric_limits<int32_t>::max();
+    for (auto const& free : m_free) {
+        if (free.width < width || free.height < height) continue;
+        auto const short_side = std::min(free.width - width, free.height - height);
+        auto const long_side  = std::max(free.width - width, free.height - height);
+        if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+            best       = rect{free.x, free.y, width, height};
+            best_short = short_side;
+            best_long  = long_side;
+        }
+    }
+    if (!best) return std::nullopt;
+
+    split(*best);
+    prune();
+    m_used += i64(width) * i64(height);
+    return best;
+}
+
+auto max_rects::remove(rect const& used) -> void {
+    m_used -= i64(used.width) * i64(used.height);
+    // Merging only finds neighbours sharing a whole edge, start over once
+    // nothing is left so an emptied page is as good as new.
+    if (m_used == 0) {
+        clear();
+        return;
+    }
+    m_free.push_back(used);
+    merge();
+    prune();
+}
+
+auto max_rects::clear() -> void {
+    m_used = 0;
+    m_free.assign(1, rect{0, 0, m_width, m_height});
+}
+
+auto max_rects::split(rect const& used) -> void {
+    std::vector<rect> next;
+    next.reserve(m_free.size() + 4);
+    for (auto const& free : m_free) {
+        if (!overlaps(free, used)) {
+            next.push_back(free);
+            continue;
+        }
+        auto const right = used.x + used.width;
+        auto const top   = used.y + used.height;
+        if (used.x > free.x) next.push_back({free.x, free.y, used.x - free.x, free.height});
+        if (right < free.x + free.width) next.push_back({right, free.y, free.x + free.width - right, free.height});
+        if (used.y > free.y) next.push_back({free.x, free.y, free.width, used.y - free.y});
+        if (top < free.y + free.height) next.push_back({free.x, top, free.width, free.y + free.height - top});
+    }
+    m_free.swap(next);
+}
+
+auto max_rects::merge() -> void {
+    for (auto is_merged = true; is_merged;) {
+        is_merged = false;
+        for (usize i = 0; i < m_free.size() && !is_merged; i++) {
+            for (usize j = i + 1; j < m_free.size() && !is_merged; j++) {
+                auto& a = m_free[i];
+                auto const& b = m_free[j];
+                if (a.y == b.y && a.height == b.height && (a.x + a.width == b.x || b.x + b.width == a.x)) {
+                    a = {std::min(a.x, b.x), a.y, a.width + b.width, a.height};
+                    is_merged = true;
+                } else if (a.x == b.x && a.width == b.width && (a.y + a.height == b.y || b.y + b.height == a.y)) {
+                    a = {a.x, std::min(a.y, b.y), a.width, a.height + b.height};
+                    is_merged = true;
+                }
+                if (is_merged) m_free.erase(std::begin(m_free) + isize(j));
+            }
+        }
+    }
+}
+
+auto max_rects::prune() -> void {
+    // Of two equal rectangles the first is dropped, it is contained by the
+    // second which is still there.
+    std::vector<bool> is_redundant(m_free.size(), false);
+    for (usize i = 0; i < m_free.size(); i++)
+        for (usize j = 0; j < m_free.size(); j++)
+            if (i != j && !is_redundant[j] && contains(m_free[j], m_free[i])) {
+                is_redundant[i] = true;
+                break;
+            }
+    usize kept = 0;
+    for (usize i = 0; i < m_free.size(); i++)
+        if (!is_redundant[i]) m_free[kept++] = m_free[i];
+    m_free.resize(kept);
+}
+
+atlas::atlas(int32_t const& page_size, int32_t const& gutter, int32_t const& max_pages)
+    : m_page_size(page_size), m_gutter(gutter), m_max_pages(std::max(max_pages, 1)) {
+    if (gutter <= 0 || !std::has_single_bit(uint32_t(gutter)) || page_size <= 0 || page_size % gutter != 0)
+        throw std::runtime_error("atlas gutter must be a power of two dividing the page size");
+    // A gutter of 4 leaves 2 texels at level 1 and 1 at level 2.
+    m_levels = std::countr_zero(uint32_t(gutter)) + 1;
+}
+
+atlas::~atlas() {
+    if (m_id) glDeleteTextures(1, &m_id);
+}
+
+auto atlas::insert(image const& source) -> std::optional<handle> {
+    if (!source.buffer() || pixel::is_float(source.type())) return std::nullopt;
+    if (source.type() == pixel::type::u8)
+        return insert(source.buffer(), source.width(), source.height(), source.channels());
+    std::vector<u8> narrowed(usize(source.width()) * usize(source.height()) * usize(source.channels()));
+    pixel::narrow(reinterpret_cast<u16 const*>(source.buffer()), narrowed.data(), narrowed.size());
+    return insert(narrowed.data(), source.width(), source.height(), source.channels());
+}
+
+auto atlas::insert(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels)
+    -> std::optional<handle> {
+    LUMA_PROFILE_SCOPE("atlas::insert");
+    auto const gutter = m_gutter;
+    auto const cells  = m_page_size / gutter;
+    auto const padded_width  = width + 2 * gutter;
+    auto const padded_height = height + 2 * gutter;
+    auto const cell_width    = (padded_width + gutter - 1) / gutter;
+    auto const cell_height   = (padded_height + gutter - 1) / gutter;
+    if (!pixels || width <= 0 || height <= 0 || cell_width > cells || cell_height > cells) return std::nullopt;
+
+    usize page = 0;
+    std::optional<max_rects::rect> cell;
+    for (; page < m_pages.size(); page++)
+        if ((cell = m_pages[page].insert(cell_width, cell_height))) break;
+    if (!cell) {
+        if (int32_t(m_pages.size()) >= m_max_pages) return std::nullopt;
+        if (int32_t(m_pages.size()) >= m_layers) allocate(std::max(m_layers * 2, 1));
+        if (int32_t(m_pages.size()) >= m_layers) return std::nullopt;
+        m_pages.emplace_back(cells, cells);
+        page = m_pages.size() - 1;
+        cell = m_pages[page].insert(cell_width, cell_height);
+    }
+
+    // The gutter repeats the edge pixels, like clamping would. It is widened
+    // to fill the whole cells so every mip of them halves exactly.
+    auto const cells_width  = cell->width * gutter;
+    auto const cells_height = cell->height * gutter;
+    std::vector<u8> padded(usize(cells_width) * usize(cells_height) * 4);
+    std::vector<u8> row(usize(width) * 4);
+    for (int32_t y = 0; y < cells_height; y++) {
+        auto const source = std::clamp(y - gutter, 0, height - 1);
+        pixel::expand_rgba(pixels + usize(source) * usize(width) * usize(channels), channels, row.data(), usize(width));
+        auto out = padded.data() + usize(y) * usize(cells_width) * 4;
+        for (int32_t x = 0; x < cells_width; x++)
+            std::memcpy(out + usize(x) * 4, row.data() + usize(std::clamp(x - gutter, 0, width - 1)) * 4, 4);
+    }
+
+    // Only the new cells get mips, built here rather than regenerating the
+    // whole array. Cell origins are multiples of the gutter, so they stay
+    // aligned down to the last level.
+    auto const x = cell->x * gutter;
+    auto const y = cell->y * gutter;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, GLint(page), cells_width, cells_height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+    resample::surface level;
+    std::vector<u8> mip;
+    for (int32_t l = 1; l < m_levels; l++) {
+        auto const mip_width  = cells_width >> l;
+        auto const mip_height = cells_height >> l;
+        level = l == 1
+            ? resample::resize(padded.data(), cells_width, cells_height, 4, mip_width, mip_height, resample::filter::box)
+            : resample::resize(level, mip_width, mip_height, resample::filter::box);
+        mip.resize(usize(mip_width) * usize(mip_height) * 4);
+        resample::encode(level, 4, mip.data());
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, l, x >> l, y >> l, GLint(page), mip_width, mip_height, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, mip.data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    auto const size = f32(m_page_size);
+    entry e{};
+    e.cells = *cell;
+    e.place = {int32_t(page), x + gutter, y + gutter, width, height,
+               {f32(x + gutter) / size, f32(y + gutter) / size, f32(width) / size, f32(height) / size}};
+    auto const id = m_next++;
+    m_regions.emplace(id, e);
+    return id;
+}
+
+auto atlas::remove(handle const& id) -> void {
+    auto it = m_regions.find(id);
+    if (it == std::end(m_regions)) return;
+    m_pages[usize(it->second.place.page)].remove(it->second.cells);
+    m_regions.erase(it);
+}
+
+auto atlas::bind(uint32_t const& unit) -> void {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+}
+
+auto atlas::statistics() const -> stats {
+    stats result{};
+    result.entries = m_regions.size();
+    result.pages   = m_pages.size();
+    for (int32_t level = 0; level < m_levels; level++) {
+        auto const side = usize(std::max(m_page_size >> level, 1));
+        result.gpu_bytes += side * side * 4 * usize(m_layers);
+    }
+    i64 used = 0;
+    for (auto const& page : m_pages) used += page.used_area();
+    auto const cells = i64(m_page_size / m_gutter);
+    result.occupancy = m_pages.empty() ? 0.0f : f32(used) / f32(cells * cells * i64(m_pages.size()));
+    return result;
+}
+
+auto atlas::allocate(int32_t const& requested) -> void {
+    LUMA_PROFILE_SCOPE("atlas::allocate");
+    // Whatever max_pages asked for, the array can't have more layers than GL
+    // allows. Clamped on the first allocation, before any page exists.
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    if (max_layers > 0) m_max_pages = std::min(m_max_pages, int32_t(max_layers));
+    auto const layers = std::min(requested, m_max_pages);
+    if (layers <= m_layers) return;
+
+    uint32_t id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+    for (int32_t level = 0; level < m_levels; level++) {
+        auto const side = std::max(m_page_size >> level, 1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, side, side, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, m_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    if (m_id) {
+        // 4.1 has no glCopyImageSubData, blit the pages over layer by layer,
+        // every level so the mips built on insert are kept.
+        // The blit is clipped by the scissor test, a viewer's scissor would
+        // leave parts of the pages behind.
+        GLint read = 0, draw = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw);
+        auto const is_scissored = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        uint32_t framebuffers[2];
+        glGenFramebuffers(2, framebuffers);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        for (int32_t level = 0; level < m_levels; level++) {
+            auto const side = std::max(m_page_size >> level, 1);
+            for (int32_t layer = 0; layer < m_layers; layer++) {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_id, level, layer);
+                glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id, level, layer);
+                glBlitFramebuffer(0, 0, side, side, 0, 0, side, side, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, uint32_t(read));
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, uint32_t(draw));
+        glDeleteFramebuffers(2, framebuffers);
+        if (is_scissored) glEnable(GL_SCISSOR_TEST);
+        glDeleteTextures(1, &m_id);
+    }
+    m_id     = id;
+    m_layers = layers;
+}
+
+}
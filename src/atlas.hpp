@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "luma.hpp"
+#include "image.hpp"
+#include "glm/glm.hpp"
+
+namespace luma {
+
+// MaxRects bin packing, best short side fit. Free space is kept as the list
+// of maximal free rectangles, a placement splits every one it overlaps.
+// Removed rectangles go back to the list and are merged with neighbours
+// sharing a whole edge, so space is reused without repacking.
+class max_rects {
+  public:
+    struct rect {
+        int32_t x      = 0;
+        int32_t y      = 0;
+        int32_t width  = 0;
+        int32_t height = 0;
+    };
+
+  public:
+    max_rects(int32_t const& width, int32_t const& height);
+
+    auto insert(int32_t const& width, int32_t const& height) -> std::optional<rect>;
+    // Must be a rectangle insert() returned.
+    auto remove(rect const& used) -> void;
+    auto clear() -> void;
+
+    auto used_area() const -> i64 { return m_used; }
+    auto occupancy() const -> f32 { return f32(m_used) / f32(i64(m_width) * i64(m_height)); }
+
+  private:
+    auto split(rect const& used) -> void;
+    auto merge() -> void;
+    auto prune() -> void;
+
+  private:
+    int32_t m_width;
+    int32_t m_height;
+    i64     m_used = 0;
+    std::vector<rect> m_free;
+};
+
+// Packs many small images into the layers of one GL_TEXTURE_2D_ARRAY, so a
+// batch with batch::source::array draws them all at once. Each image is
+// surrounded by a gutter of its edge pixels and placed on a grid of the
+// gutter size, which keeps mip levels up to log2(gutter) free of bleeding
+// from neighbours. The mips of an image are built on the CPU when it is
+// inserted. Pages are added as they fill up, the array is grown by copying
+// on the GPU.
+//
+// Uploads go straight to GL, use it from the thread owning the context.
+class atlas {
+  public:
+    using handle = u32;
+
+    struct region {
+        int32_t   page   = 0;
+        int32_t   x      = 0;   // pixels, the image without its gutter
+        int32_t   y      = 0;
+        int32_t   width  = 0;
+        int32_t   height = 0;
+        glm::vec4 uv{0.0f, 0.0f, 1.0f, 1.0f};  // offset (xy) and scale (zw) of the plane's a_uv
+    };
+
+    struct stats {
+        usize entries;
+        usize pages;
+        usize gpu_bytes;
+        f32   occupancy;    // of the pages in use, gutters included
+    };
+
+  public:
+    // `gutter` a power of two dividing `page_size`.
+    atlas(int32_t const& page_size = 2048, int32_t const& gutter = 4, int32_t const& max_pages = 64);
+    ~atlas();
+    atlas(atlas const&) = delete;
+    auto operator=(atlas const&) -> atlas& = delete;
+
+    // Empty when the image is larger than a page or every page is full.
+    // Pages are 8-bit, 16-bit images are narrowed and float ones refused.
+    auto insert(image const& source) -> std::optional<handle>;
+    auto insert(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels)
+        -> std::optional<handle>;
+    auto remove(handle const& id) -> void;
+    auto contains(handle const& id) const -> bool { return m_regions.contains(id); }
+    auto get(handle const& id) const -> region const& { return m_regions.at(id).place; }
+
+    auto bind(uint32_t const& unit = 0) -> void;
+    auto id() const -> uint32_t { return m_id; }
+    auto page_size() const -> int32_t { return m_page_size; }
+    auto statistics() const -> stats;
+
+  private:
+    struct entry {
+        region          place;
+        max_rects::rect cells;
+    };
+
+    // Grows the array to `requested` layers, clamped to max_pages and GL's limit.
+    auto allocate(int32_t const& requested) -> void;
+
+  private:
+    uint32_t m_id = 0;
+    int32_t  m_page_size;
+    int32_t  m_gutter;
+    int32_t  m_levels;
+    int32_t  m_max_pages;
+    int32_t  m_layers = 0;      // allocated, pages in use are m_pages.size()
+    handle   m_next = 1;
+    std::vector<max_rects> m_pages;
+    std::unordered_map<handle, entry> m_regions;
+};
+
+}
@@ -0,0 +1,91 @@
+#include "batch.hpp"
+
+#include "glad/glad.h"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace luma {
+
+char const* batch::vertex_shader = R"(#version 410 core
+layout (location = 0) in vec3 a_position;
+layout (location = 1) in vec4 a_color;
+layout (location = 2) in vec2 a_uv;
+layout (location = 3) in mat4 a_model;
+layout (location = 7) in vec4 a_tint;
+layout (location = 8) in vec4 a_atlas;
+layout (location = 9) in float a_layer;
+
+out vec4 io_color;
+out vec2 io_uv;
+flat out float io_layer;
+
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+void main() {
+    io_color = a_tint;
+    io_uv    = a_atlas.xy + a_uv * a_atlas.zw;
+    io_layer = a_layer;
+    gl_Position = u_projection * u_view * a_model * vec4(a_position, 1.0f);
+}
+)";
+
+char const* batch::fragment_shader = R"(#version 410 core
+layout(location = 0) out vec4 color;
+
+in vec4 io_color;
+in vec2 io_uv;
+
+uniform sampler2D u_texture;
+
+void main() {
+    color = texture(u_texture, io_uv) * io_color;
+}
+)";
+
+char const* batch::array_fragment_shader = R"(#version 410 core
+layout(location = 0) out vec4 color;
+
+in vec4 io_color;
+in vec2 io_uv;
+flat in float io_layer;
+
+uniform sampler2DArray u_texture;
+
+void main() {
+    color = texture(u_texture, vec3(io_uv, io_layer)) * io_color;
+}
+)";
+
+batch::batch(ref<mesh::primitive> const& primitive, usize const& capacity, source const& from) : m_primitive(primitive) {
+    m_shader = shader::create(vertex_shader, from == source::array ? array_fragment_shader : fragment_shader);
+    m_instances.reserve(capacity);
+
+    m_array           = buffer::array::create();
+    m_instance_buffer = buffer::vertex::create(capacity * sizeof(instance));
+    m_array->add_vertex_buffer(m_primitive->get_vertex_buffer(), mesh::vertex_format);
+    m_array->add_vertex_buffer(m_instance_buffer, instance_format);
+    m_array->set_index_buffer(m_primitive->get_index_buffer());
+}
+batch::batch(usize const& capacity, source const& from) : batch(mesh::registry::shared().plane(), capacity, from) {}
+
+auto batch::render(glm::mat4 const& view, glm::mat4 const& projection) -> void {
+    if (m_instances.empty()) return;
+    m_instance_buffer->set_data(m_instances.data(), m_instances.size() * sizeof(instance));
+
+    m_shader->bind();
+    m_shader->num("u_texture", 0);
+    m_shader->mat4("u_view", glm::value_ptr(view));
+    m_shader->mat4("u_projection", glm::value_ptr(projection));
+
+    m_array->bind();
+    auto const is_strip = m_primitive->get_surface()->topology() == mesh::topology::triangle_strip;
+    if (is_strip) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(mesh::restart_index);
+    }
+    glDrawElementsInstanced(is_strip ? GL_TRIANGLE_STRIP : GL_TRIANGLES, m_primitive->count(), GL_UNSIGNED_INT, 0,
+                            GLsizei(m_instances.size()));
+    if (is_strip) glDisable(GL_PRIMITIVE_RESTART);
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "luma.hpp"
+#include "shader.hpp"
+#include "buffer.hpp"
+#include "primitive.hpp"
+#include "glm/glm.hpp"
+
+namespace luma {
+
+// Draws every instance of a primitive with a single glDrawElementsInstanced.
+// Instances are refilled each frame and uploaded in one go by render().
+class batch {
+  public:
+    // What is bound to unit 0. An array lets instances pick their atlas page.
+    enum class source : uint8_t {
+        texture,
+        array,
+    };
+
+    struct instance {
+        glm::mat4 model{1.0f};
+        glm::vec4 tint {1.0f, 1.0f, 1.0f, 1.0f};
+        glm::vec4 atlas{0.0f, 0.0f, 1.0f, 1.0f};  // uv offset (xy) and scale (zw)
+        f32       layer = 0.0f;                     // texture array layer
+    };
+
+  public:
+    batch(ref<mesh::primitive> const& primitive, usize const& capacity = 1024, source const& from = source::texture);
+    batch(usize const& capacity = 1024, source const& from = source::texture);
+    ~batch() = default;
+
+    auto clear() -> void { m_instances.clear(); }
+    auto add(instance const& instance) -> void { m_instances.push_back(instance); }
+    auto instances() -> std::vector<instance>& { return m_instances; }
+    auto size() const -> usize { return m_instances.size(); }
+
+    // Expects the texture to be bound to unit 0.
+    auto render(glm::mat4 const& view, glm::mat4 const& projection) -> void;
+
+  private:
+    ref<shader>           m_shader;
+    ref<mesh::primitive>  m_primitive;
+    ref<buffer::array>    m_array;
+    ref<buffer::vertex>   m_instance_buffer;
+    std::vector<instance> m_instances;
+
+  private:
+    static char const* vertex_shader;
+    static char const* fragment_shader;
+    static char const* array_fragment_shader;
+};
+
+inline constexpr auto instance_format = buffer::make_format<batch::instance>(
+    LUMA_ATTRIBUTE(batch::instance, model, false, 1),
+    LUMA_ATTRIBUTE(batch::instance, tint,  false, 1),
+    LUMA_ATTRIBUTE(batch::instance, atlas, false, 1),
+    LUMA_ATTRIBUTE(batch::instance, layer, false, 1)
+);
+static_assert(instance_format.is_packed(), "batch::instance members and instance_format are out of sync");
+
+}
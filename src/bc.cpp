@@ -0,0 +1,589 @@
+#include "bc.hpp"
+#include "image.hpp"
+#include "pixel.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+#include "glad/glad.h"
+
+namespace luma::bc {
+
+// From EXT_texture_compression_s3tc, not in the core headers.
+constexpr uint32_t COMPRESSED_RGB_S3TC_DXT1  = 0x83F0;
+constexpr uint32_t COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+using texels = std::array<std::array<u8, 4>, 16>;
+
+auto surface::bytes() const -> usize {
+    usize total = 0;
+    for (auto const& l : levels) total += l.data.size();
+    return total;
+}
+
+auto choose(bool const& is_opaque) -> format {
+    return is_opaque ? format::bc1 : format::bc3;
+}
+
+auto block_size(format const& encoding) -> usize {
+    return encoding == format::bc1 ? 8 : 16;
+}
+
+auto gl_format(format const& encoding) -> uint32_t {
+    return encoding == format::bc1 ? COMPRESSED_RGB_S3TC_DXT1 : COMPRESSED_RGBA_S3TC_DXT5;
+}
+
+static auto put_u16(u8* out, u16 const& value) -> void {
+    out[0] = u8(value);
+    out[1] = u8(value >> 8);
+}
+
+static auto to_565(f32 const* color) -> u16 {
+    auto const r = u16(std::clamp(std::lround(color[0] * 31.0f / 255.0f), 0l, 31l));
+    auto const g = u16(std::clamp(std::lround(color[1] * 63.0f / 255.0f), 0l, 63l));
+    auto const b = u16(std::clamp(std::lround(color[2] * 31.0f / 255.0f), 0l, 31l));
+    return u16(r << 11 | g << 5 | b);
+}
+
+static auto from_565(u16 const& value, f32* color) -> void {
+    auto const r = (value >> 11) & 31;
+    auto const g = (value >> 5) & 63;
+    auto const b = value & 31;
+    color[0] = f32(r << 3 | r >> 2);
+    color[1] = f32(g << 2 | g >> 4);
+    color[2] = f32(b << 3 | b >> 2);
+}
+
+// Nearest of the four palette entries per texel, returns the squared error.
+static auto assign(texels const& block, u16 const& c0, u16 const& c1, std::array<u8, 16>& indices) -> f32 {
+    f32 palette[4][3];
+    from_565(c0, palette[0]);
+    from_565(c1, palette[1]);
+    for (int32_t c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    f32 total = 0.0f;
+    for (usize i = 0; i < 16; i++) {
+        auto best = std::numeric_limits<f32>::max();
+        for (u8 p = 0; p < 4; p++) {
+            auto const dr = palette[p][0] - block[i][0];
+            auto const dg = palette[p][1] - block[i][1];
+            auto const db = palette[p][2] - block[i][2];
+            auto const error = dr * dr + dg * dg + db * db;
+            if (error < best) {
+                best = error;
+                indices[i] = p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+// Least squares endpoints for fixed indices.
+static auto refine(texels const& block, std::array<u8, 16> const& indices, f32* e0, f32* e1) -> bool {
+    constexpr f32 weight[4]{1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    f32 aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    f32 ax[3]{}, bx[3]{};
+    for (usize i = 0; i < 16; i++) {
+        auto const a = weight[indices[i]];
+        auto const b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int32_t c = 0; c < 3; c++) {
+            ax[c] += a * block[i][usize(c)];
+            bx[c] += b * block[i][usize(c)];
+        }
+    }
+    auto const det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) return false;
+    for (int32_t c = 0; c < 3; c++) {
+        e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+        e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+    }
+    return true;
+}
+
+struct color_fit {
+    u16 c0 = 0;
+    u16 c1 = 0;
+    std::array<u8, 16> indices{};
+    f32 error = std::numeric_limits<f32>::max();
+};
+
+static auto try_endpoints(texels const& block, f32 const* e0, f32 const* e1, color_fit& best) -> void {
+    color_fit fit;
+    fit.c0 = to_565(e0);
+    fit.c1 = to_565(e1);
+    fit.error = assign(block, fit.c0, fit.c1, fit.indices);
+    if (fit.error < best.error) best = fit;
+}
+
+static auto bounding_box(texels const& block, f32* e0, f32* e1) -> void {
+    f32 lo[3]{255.0f, 255.0f, 255.0f}, hi[3]{0.0f, 0.0f, 0.0f};
+    f32 mean[3]{};
+    for (auto const& t : block)
+        for (int32_t c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], f32(t[usize(c)]));
+            hi[c] = std::max(hi[c], f32(t[usize(c)]));
+            mean[c] += t[usize(c)] / 16.0f;
+        }
+    // Pick the box diagonal the colours actually run along.
+    f32 rg = 0.0f, rb = 0.0f;
+    for (auto const& t : block) {
+        rg += (t[0] - mean[0]) * (t[1] - mean[1]);
+        rb += (t[0] - mean[0]) * (t[2] - mean[2]);
+    }
+    if (rg < 0.0f) std::swap(lo[1], hi[1]);
+    if (rb < 0.0f) std::swap(lo[2], hi[2]);
+    // Inset a little, the extremes are rarely hit exactly.
+    for (int32_t c = 0; c < 3; c++) {
+        auto const inset = (hi[c] - lo[c]) / 16.0f;
+        e0[c] = hi[c] - inset;
+        e1[c] = lo[c] + inset;
+    }
+}
+
+static auto principal_axis(texels const& block, f32* e0, f32* e1) -> void {
+    f32 mean[3]{};
+    for (auto const& t : block)
+        for (int32_t c = 0; c < 3; c++) mean[c] += t[usize(c)] / 16.0f;
+    f32 cov[6]{};
+    for (auto const& t : block) {
+        f32 const d[3]{t[0] - mean[0], t[1] - mean[1], t[2] - mean[2]};
+        cov[0] += d[0] * d[0];
+        cov[1] += d[0] * d[1];
+        cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1];
+        cov[4] += d[1] * d[2];
+        cov[5] += d[2] * d[2];
+    }
+    // Power iteration, converges in a handful of steps for 3x3.
+    f32 axis[3]{1.0f, 1.0f, 1.0f};
+    for (int32_t i = 0; i < 8; i++) {
+        f32 const next[3]{
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+        };
+        auto const length = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+        if (length < 1e-6f) break;
+        for (int32_t c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+
+    auto lo = std::numeric_limits<f32>::max(), hi = -lo;
+    for (auto const& t : block) {
+        auto const d = (t[0] - mean[0]) * axis[0] + (t[1] - mean[1]) * axis[1] + (t[2] - mean[2]) * axis[2];
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    auto const norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    if (norm > 0.0f) {
+        lo /= norm;
+        hi /= norm;
+    }
+    for (int32_t c = 0; c < 3; c++) {
+        e0[c] = mean[c] + axis[c] * hi;
+        e1[c] = mean[c] + axis[c] * lo;
+    }
+}
+
+static auto encode_color(texels const& block, quality const& level, u8* out) -> void {
+    color_fit best;
+    f32 e0[3], e1[3];
+    if (level != quality::normal) {
+        bounding_box(block, e0, e1);
+        try_endpoints(block, e0, e1, best);
+    }
+    if (level != quality::fast) {
+        principal_axis(block, e0, e1);
+        try_endpoints(block, e0, e1, best);
+        auto const passes = level == quality::high ? 2 : 1;
+        for (int32_t i = 0; i < passes && best.error > 0.0f; i++) {
+            if (!refine(block, best.indices, e0, e1)) break;
+            try_endpoints(block, e0, e1, best);
+        }
+    }
+
+    // c0 > c1 selects the four colour mode, equal endpoints would select the
+    // three colour one where index 3 is black.
+    if (best.c0 < best.c1) {
+        std::swap(best.c0, best.c1);
+        for (auto& i : best.indices) i = u8(i ^ 1);
+    } else if (best.c0 == best.c1) {
+        best.indices.fill(0);
+    }
+
+    u32 bits = 0;
+    for (usize i = 0; i < 16; i++) bits |= u32(best.indices[i]) << (i * 2);
+    put_u16(out, best.c0);
+    put_u16(out + 2, best.c1);
+    std::memcpy(out + 4, &bits, 4);
+}
+
+// Eight interpolated values when a0 > a1, otherwise six plus 0 and 255.
+static auto alpha_palette(u8 const& a0, u8 const& a1, std::array<i32, 8>& palette) -> void {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (i32 i = 1; i < 7; i++) palette[usize(i + 1)] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (i32 i = 1; i < 5; i++) palette[usize(i + 1)] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static auto fit_alpha(texels const& block, u8 const& a0, u8 const& a1, u64& bits) -> i32 {
+    std::array<i32, 8> palette;
+    alpha_palette(a0, a1, palette);
+    i32 total = 0;
+    bits = 0;
+    for (usize i = 0; i < 16; i++) {
+        i32 best = std::numeric_limits<i32>::max();
+        u64 index = 0;
+        for (usize p = 0; p < 8; p++) {
+            auto const error = std::abs(palette[p] - i32(block[i][3]));
+            if (error < best) {
+                best  = error;
+                index = p;
+            }
+        }
+        total += best * best;
+        bits  |= index << (i * 3);
+    }
+    return total;
+}
+
+static auto encode_alpha(texels const& block, quality const& level, u8* out) -> void {
+    u8 lo = 255, hi = 0, inner_lo = 255, inner_hi = 0;
+    for (auto const& t : block) {
+        lo = std::min(lo, t[3]);
+        hi = std::max(hi, t[3]);
+        if (t[3] != 0 && t[3] != 255) {
+            inner_lo = std::min(inner_lo, t[3]);
+            inner_hi = std::max(inner_hi, t[3]);
+        }
+    }
+
+    u8  a0 = hi, a1 = lo;
+    u64 bits = 0;
+    if (hi != lo) {
+        auto error = fit_alpha(block, hi, lo, bits);
+        // Blocks with both hard edges and soft texels keep 0 and 255 exact.
+        if (level == quality::high && inner_lo <= inner_hi) {
+            u64 other = 0;
+            if (fit_alpha(block, inner_lo, inner_hi, other) < error) {
+                a0   = inner_lo;
+                a1   = inner_hi;
+                bits = other;
+            }
+        }
+    }
+    out[0] = a0;
+    out[1] = a1;
+    for (usize i = 0; i < 6; i++) out[2 + i] = u8(bits >> (i * 8));
+}
+
+// Clamps at the right and top edge so partial blocks repeat their last
+// texel, gray is replicated and missing alpha is opaque.
+static auto gather(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels,
+                   int32_t const& bx, int32_t const& by, texels& block) -> void {
+    for (int32_t y = 0; y < 4; y++) {
+        auto const sy = std::min(by * 4 + y, height - 1);
+        for (int32_t x = 0; x < 4; x++) {
+            auto const sx = std::min(bx * 4 + x, width - 1);
+            auto const p  = pixels + (usize(sy) * usize(width) + usize(sx)) * usize(channels);
+            auto& t = block[usize(y * 4 + x)];
+            auto const color = channels >= 3;
+            t[0] = p[0];
+            t[1] = color ? p[1] : p[0];
+            t[2] = color ? p[2] : p[0];
+            t[3] = channels == 2 || channels == 4 ? p[channels - 1] : 255;
+        }
+    }
+}
+
+auto encode(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels,
+            format const& encoding, quality const& level) -> bc::level {
+    bc::level result;
+    result.width  = width;
+    result.height = height;
+    auto const columns = (width + 3) / 4;
+    auto const rows    = (height + 3) / 4;
+    auto const size    = block_size(encoding);
+    result.data.resize(usize(columns) * usize(rows) * size);
+
+    thread_pool::shared().parallel_for(0, usize(rows), [&](usize const& begin, usize const& end) {
+        texels block;
+        for (auto by = begin; by < end; by++) {
+            for (int32_t bx = 0; bx < columns; bx++) {
+                gather(pixels, width, height, channels, bx, int32_t(by), block);
+                auto out = result.data.data() + (by * usize(columns) + usize(bx)) * size;
+                if (encoding == format::bc3) {
+                    encode_alpha(block, level, out);
+                    out += 8;
+                }
+                encode_color(block, level, out);
+            }
+        }
+    }, 4);
+    return result;
+}
+
+auto encode(image const& source, format const& encoding, quality const& level) -> surface {
+    LUMA_PROFILE_SCOPE("bc::encode");
+    surface result;
+    result.encoding = encoding;
+    if (!source.buffer() || pixel::is_float(source.type())) return result;
+    // The endpoints are 8-bit anyway, 16-bit samples are narrowed first.
+    std::vector<u8> narrowed;
+    auto const encode_level = [&](image const& from) {
+        if (from.type() == pixel::type::u8)
+            return encode(from.buffer(), from.width(), from.height(), from.channels(), encoding, level);
+        narrowed.resize(usize(from.width()) * usize(from.height()) * usize(from.channels()));
+        pixel::narrow(reinterpret_cast<u16 const*>(from.buffer()), narrowed.data(), narrowed.size());
+        return encode(narrowed.data(), from.width(), from.height(), from.channels(), encoding, level);
+    };
+    result.levels.push_back(encode_level(source));
+    for (auto const& mip : source.mips()) result.levels.push_back(encode_level(*mip));
+    return result;
+}
+
+// Index rows within a block, BC1 keeps one per byte, BC3 alpha 12 bits each.
+static auto flip_block(u8* block, format const& encoding, int32_t const& rows) -> void {
+    if (encoding == format::bc3) {
+        u64 bits = 0, flipped = 0;
+        for (usize i = 0; i < 6; i++) bits |= u64(block[2 + i]) << (i * 8);
+        for (int32_t r = 0; r < 4; r++) {
+            auto const to = r < rows ? rows - 1 - r : r;
+            flipped |= ((bits >> (r * 12)) & 0xfff) << (to * 12);
+        }
+        for (usize i = 0; i < 6; i++) block[2 + i] = u8(flipped >> (i * 8));
+        block += 8;
+    }
+    u8 flipped[4];
+    for (int32_t r = 0; r < 4; r++) flipped[r < rows ? rows - 1 - r : r] = block[4 + r];
+    std::memcpy(block + 4, flipped, 4);
+}
+
+static auto decode_color(u8 const* in, bool const& is_bc1, u8* out, usize const& stride) -> void {
+    u16 c0 = 0, c1 = 0;
+    std::memcpy(&c0, in, 2);
+    std::memcpy(&c1, in + 2, 2);
+    std::array<std::array<f32, 3>, 4> palette{};
+    from_565(c0, palette[0].data());
+    from_565(c1, palette[1].data());
+    // BC3 colour blocks always use the four colour mode.
+    auto const is_four = !is_bc1 || c0 > c1;
+    for (usize c = 0; c < 3; c++) {
+        palette[2][c] = is_four ? (2.0f * palette[0][c] + palette[1][c]) / 3.0f : (palette[0][c] + palette[1][c]) / 2.0f;
+        palette[3][c] = is_four ? (palette[0][c] + 2.0f * palette[1][c]) / 3.0f : 0.0f;
+    }
+    u32 bits = 0;
+    std::memcpy(&bits, in + 4, 4);
+    for (usize i = 0; i < 16; i++) {
+        auto const& color = palette[(bits >> (i * 2)) & 3];
+        auto p = out + (i / 4) * stride + (i % 4) * 4;
+        for (usize c = 0; c < 3; c++) p[c] = u8(std::lround(color[c]));
+    }
+}
+
+auto decode(bc::level const& level, format const& encoding) -> std::vector<u8> {
+    auto const columns = (level.width + 3) / 4;
+    auto const rows    = (level.height + 3) / 4;
+    auto const stride  = usize(columns) * 16;
+    // Decoded whole blocks first, then cropped to the level's size.
+    std::vector<u8> padded(stride * usize(rows) * 4, 255);
+    for (int32_t by = 0; by < rows; by++) {
+        for (int32_t bx = 0; bx < columns; bx++) {
+            auto in  = level.data.data() + (usize(by) * usize(columns) + usize(bx)) * block_size(encoding);
+            auto out = padded.data() + usize(by) * 4 * stride + usize(bx) * 16;
+            if (encoding == format::bc3) {
+                u64 bits = 0;
+                for (usize i = 0; i < 6; i++) bits |= u64(in[2 + i]) << (i * 8);
+                std::array<i32, 8> palette;
+                alpha_palette(in[0], in[1], palette);
+                for (usize i = 0; i < 16; i++) out[(i / 4) * stride + (i % 4) * 4 + 3] = u8(palette[(bits >> (i * 3)) & 7]);
+                in += 8;
+            }
+            decode_color(in, encoding == format::bc1, out, stride);
+        }
+    }
+    std::vector<u8> result(usize(level.width) * usize(level.height) * 4);
+    for (int32_t y = 0; y < level.height; y++)
+        std::memcpy(result.data() + usize(y) * usize(level.width) * 4, padded.data() + usize(y) * stride,
+                    usize(level.width) * 4);
+    return result;
+}
+
+auto flip(bc::level& level, format const& encoding) -> void {
+    // Flipped rows straddle the original blocks, which no index shuffle can
+    // express, so such levels go through the texels and are encoded again.
+    if (level.height > 4 && level.height % 4 != 0) {
+        auto pixels = decode(level, encoding);
+        pixel::flip_rows(pixels.data(), usize(level.width) * 4, level.height);
+        level = encode(pixels.data(), level.width, level.height, 4, encoding);
+        return;
+    }
+    auto const columns = usize(level.width + 3) / 4;
+    auto const rows    = usize(level.height + 3) / 4;
+    auto const stride  = columns * block_size(encoding);
+    auto const valid   = level.height < 4 ? level.height : 4;
+    for (usize r = 0; r < rows / 2; r++)
+        std::swap_ranges(level.data.data() + r * stride, level.data.data() + (r + 1) * stride,
+                         level.data.data() + (rows - 1 - r) * stride);
+    for (usize i = 0; i < level.data.size(); i += block_size(encoding))
+        flip_block(level.data.data() + i, encoding, valid);
+}
+
+// KTX 1.1, little endian only.
+static constexpr u8 KTX_IDENTIFIER[12]{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+static constexpr u32 KTX_ENDIANNESS = 0x04030201;
+
+struct ktx_header {
+    u32 endianness;
+    u32 gl_type;
+    u32 gl_type_size;
+    u32 gl_format;
+    u32 gl_internal_format;
+    u32 gl_base_internal_format;
+    u32 width;
+    u32 height;
+    u32 depth;
+    u32 array_elements;
+    u32 faces;
+    u32 levels;
+    u32 key_value_bytes;
+};
+
+auto load(std::string const& filename) -> ref<surface> {
+    LUMA_PROFILE_SCOPE("bc::load");
+    std::ifstream file{filename, std::ios::binary};
+    auto fail = [&](char const* reason) -> ref<surface> {
+        std::cerr << "ERROR::BC: " << filename << ": " << reason << '\n';
+        return nullptr;
+    };
+    if (!file) return fail("cannot open");
+
+    u8 identifier[12];
+    ktx_header header{};
+    file.read(reinterpret_cast<char*>(identifier), sizeof(identifier));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) != 0) return fail("not a KTX file");
+    if (header.endianness != KTX_ENDIANNESS) return fail("big endian KTX is not supported");
+
+    auto result = make_ref<surface>();
+    if (header.gl_internal_format == COMPRESSED_RGB_S3TC_DXT1) result->encoding = format::bc1;
+    else if (header.gl_internal_format == COMPRESSED_RGBA_S3TC_DXT5) result->encoding = format::bc3;
+    else return fail("only BC1 and BC3 are supported");
+    if (header.depth > 1 || header.array_elements > 0 || header.faces != 1 || header.width == 0 || header.height == 0)
+        return fail("only single 2D textures are supported");
+    if (header.width > u32(std::numeric_limits<i32>::max()) || header.height > u32(std::numeric_limits<i32>::max()))
+        return fail("dimensions out of range");
+
+    // Sizes read from the file are checked against what is left of it before
+    // anything is allocated, a corrupt header must not ask for gigabytes.
+    auto const start = file.tellg();
+    file.seekg(0, std::ios::end);
+    auto const length = usize(file.tellg());
+    file.seekg(start);
+    auto remaining = [&] { return length - usize(file.tellg()); };
+    if (header.key_value_bytes > remaining()) return fail("truncated key/value data");
+
+    // Without the key the orientation is unknown, assume GL's.
+    auto is_top_first = false;
+    std::vector<char> key_values(header.key_value_bytes);
+    file.read(key_values.data(), isize(key_values.size()));
+    for (usize at = 0; at + 4 <= key_values.size();) {
+        u32 size = 0;
+        std::memcpy(&size, key_values.data() + at, 4);
+        if (at + 4 + size > key_values.size()) break;
+        std::string_view const entry{key_values.data() + at + 4, size};
+        auto const split = entry.find('\0');
+        if (entry.substr(0, split) == "KTXorientation" && split != entry.npos)
+            is_top_first = entry.find("T=d", split) != entry.npos;
+        at += 4 + ((size + 3) & ~3u);
+    }
+
+    auto const count = std::max<u32>(header.levels, 1);
+    auto width  = i32(header.width);
+    auto height = i32(header.height);
+    for (u32 i = 0; i < count; i++) {
+        u32 size = 0;
+        file.read(reinterpret_cast<char*>(&size), 4);
+        auto const expected = usize((width + 3) / 4) * usize((height + 3) / 4) * block_size(result->encoding);
+        if (!file || size != expected || size > remaining()) return fail("truncated or inconsistent level");
+
+        bc::level l{width, height, std::vector<u8>(size)};
+        file.read(reinterpret_cast<char*>(l.data.data()), size);
+        if (!file) return fail("truncated level data");
+        if (is_top_first) flip(l, result->encoding);
+        result->levels.push_back(std::move(l));
+        width  = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return result;
+}
+
+auto save(surface const& surface, std::string const& filename) -> bool {
+    LUMA_PROFILE_SCOPE("bc::save");
+    if (surface.levels.empty()) return false;
+    std::ofstream file{filename, std::ios::binary};
+    if (!file) return false;
+
+    constexpr char key[]   = "KTXorientation";
+    constexpr char value[] = "S=r,T=u";
+    auto const entry   = u32(sizeof(key) + sizeof(value));
+    auto const padding = (4 - entry % 4) % 4;
+
+    ktx_header header{};
+    header.endianness              = KTX_ENDIANNESS;
+    header.gl_type_size            = 1;
+    header.gl_internal_format      = gl_format(surface.encoding);
+    header.gl_base_internal_format = surface.encoding == format::bc1 ? GL_RGB : GL_RGBA;
+    header.width                   = u32(surface.levels[0].width);
+    header.height                  = u32(surface.levels[0].height);
+    header.faces                   = 1;
+    header.levels                  = u32(surface.levels.size());
+    header.key_value_bytes         = 4 + entry + padding;
+
+    file.write(reinterpret_cast<char const*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const*>(&entry), 4);
+    file.write(key, sizeof(key));
+    file.write(value, sizeof(value));
+    file.write("\0\0\0", padding);
+    // Blocks are 8 or 16 bytes, levels never need padding.
+    for (auto const& l : surface.levels) {
+        auto const size = u32(l.data.size());
+        file.write(reinterpret_cast<char const*>(&size), 4);
+        file.write(reinterpret_cast<char const*>(l.data.data()), size);
+    }
+    return bool(file);
+}
+
+auto is_supported() -> bool {
+    static auto const supported = [] {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        std::vector<GLint> formats(usize(std::max(count, 0)));
+        if (count > 0) glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        auto has = [&](uint32_t const& f) { return std::find(std::begin(formats), std::end(formats), GLint(f)) != std::end(formats); };
+        return has(COMPRESSED_RGB_S3TC_DXT1) && has(COMPRESSED_RGBA_S3TC_DXT5);
+    }();
+    return supported;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "luma.hpp"
+
+namespace luma::bc {
+
+// S3TC block formats, 4x4 texels per block.
+enum class format : uint8_t {
+    bc1,    // RGB, 8 bytes a block, 4 bits a texel
+    bc3,    // RGBA, BC1 colour plus an interpolated alpha block, 8 bits a texel
+};
+
+enum class quality : uint8_t {
+    fast,       // bounding box endpoints
+    normal,     // principal axis endpoints, refined once by least squares
+    high,       // both, refined twice, alpha tries both interpolation modes
+};
+
+struct level {
+    int32_t         width  = 0;
+    int32_t         height = 0;
+    std::vector<u8> data;
+};
+
+// Levels are ready for glCompressedTexImage2D, rows bottom first like
+// luma::image.
+struct surface {
+    format             encoding = format::bc1;
+    std::vector<level> levels;
+
+    auto bytes() const -> usize;
+};
+
+// BC1 for opaque images, BC3 otherwise.
+auto choose(bool const& is_opaque) -> format;
+auto block_size(format const& encoding) -> usize;
+auto gl_format(format const& encoding) -> uint32_t;
+
+// Encodes the image and every mip it carries, block rows are split across
+// the shared thread_pool. 16-bit samples are narrowed, float images give an
+// empty surface.
+auto encode(image const& source, format const& encoding, quality const& level = quality::normal) -> surface;
+auto encode(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels,
+            format const& encoding, quality const& level = quality::normal) -> bc::level;
+
+// Mirrors a level vertically. Blocks are reordered in place when the height
+// is a multiple of 4 or below 4, other levels are decoded and encoded again,
+// which costs a little quality.
+auto flip(bc::level& level, format const& encoding) -> void;
+// RGBA, rows in the level's order.
+auto decode(bc::level const& level, format const& encoding) -> std::vector<u8>;
+
+// KTX 1.1 container with the orientation key, so files written here load
+// without flipping. Files marked top first are flipped on load.
+// Null on failure.
+auto load(std::string const& filename) -> ref<surface>;
+auto save(surface const& surface, std::string const& filename) -> bool;
+
+// Needs a current context. S3TC is an extension on 4.1, near universal on
+// desktop drivers but not guaranteed.
+auto is_supported() -> bool;
+
+}
@@ -2,6 +2,9 @@
 #include "glad/glad.h"
 #include "mesh.hpp"
 
+#include <algorithm>
+#include <iostream>
+
 namespace luma {
 namespace buffer {
 
@@ -29,13 +32,18 @@ auto layout::calculate_offset() -> void {
     }
 }
 
-vertex::vertex(void const* vertices, uint32_t const& size) : m_layout({}){
+vertex::vertex(void const* vertices, uint32_t const& size) : m_size(size), m_layout({}){
     m_id = create_buffer();
     glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 vertex::vertex(std::vector<mesh::vertex> const& vertices) : m_layout({}) {
     m_id = create_buffer();
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(luma::mesh::vertex), vertices.data(), GL_STATIC_DRAW);
+    m_size = vertices.size() * sizeof(luma::mesh::vertex);
+    glBufferData(GL_ARRAY_BUFFER, m_size, vertices.data(), GL_STATIC_DRAW);
+}
+vertex::vertex(uint32_t const& size) : m_size(size), m_layout({}) {
+    m_id = create_buffer();
+    glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
 }
 vertex::~vertex() {
     glDeleteBuffers(1, &m_id);
@@ -44,6 +52,19 @@ auto vertex::bind() const -> void {
     glBindBuffer(GL_ARRAY_BUFFER, m_id);
 }
 
+auto vertex::update(uint32_t const& offset, void const* data, uint32_t const& size) -> void {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+auto vertex::set_data(void const* data, uint32_t const& size) -> void {
+    bind();
+    if (size > m_size) m_size = std::max(size, m_size * 2);
+    glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+}
+
 auto vertex::create_buffer() const -> uint32_t {
     uint32_t id;
     glGenBuffers(1, &id);
@@ -54,6 +75,9 @@ auto vertex::create_buffer() const -> uint32_t {
 auto vertex::create(void const* vertices, uint32_t const& size) -> ref<vertex> {
     return make_ref<vertex>(vertices, size);
 }
+auto vertex::create(uint32_t const& size) -> ref<vertex> {
+    return make_ref<vertex>(size);
+}
 
 index::index(uint32_t const* indices, uint32_t const& count) : m_count(count) {
     m_id = create_buffer();
@@ -72,6 +96,12 @@ auto index::bind() const -> void {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_id);
 }
 
+auto index::update(uint32_t const& first, uint32_t const* indices, uint32_t const& count) -> void {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(uint32_t), count * sizeof(uint32_t), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
 auto index::create(uint32_t const* indices, uint32_t const& count) -> ref<index> {
     return make_ref<index>(indices, count);
 }
@@ -83,11 +113,105 @@ auto index::create_buffer() -> uint32_t {
     return id;
 }
 
+stream::stream(uint32_t const& frame_size, uint32_t const& frames)
+    : m_frame_size(frame_size), m_frames(std::max(frames, 1u)), m_fences(m_frames, nullptr) {
+    glGenBuffers(1, &m_id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    glBufferData(GL_COPY_WRITE_BUFFER, m_frame_size * m_frames, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+stream::~stream() {
+    flush();
+    for (auto fence : m_fences)
+        if (fence) glDeleteSync(GLsync(fence));
+    glDeleteBuffers(1, &m_id);
+}
+
+auto stream::bind(uint32_t const& target) const -> void {
+    glBindBuffer(target, m_id);
+}
+
+auto stream::begin_frame() -> void {
+    flush();
+    m_region = (m_region + 1) % m_frames;
+    m_head   = m_region * m_frame_size;
+
+    auto& fence = m_fences[m_region];
+    if (fence) {
+        auto sync = GLsync(fence);
+        auto flags = GLbitfield(0);
+        while (true) {
+            // Flush on the second try, the fence may still sit in the command queue.
+            auto status = glClientWaitSync(sync, flags, 1'000'000);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) break;
+            if (status == GL_WAIT_FAILED) {
+                std::cerr << "ERROR::BUFFER::STREAM: glClientWaitSync failed\n";
+                break;
+            }
+            flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        }
+        glDeleteSync(sync);
+        fence = nullptr;
+    }
+    map();
+}
+
+auto stream::allocate(uint32_t const& bytes, uint32_t const& alignment) -> allocation {
+    // 0 means no alignment, like 1.
+    auto const align  = std::max(alignment, 1u);
+    auto const offset = (m_head + align - 1) / align * align;
+    auto const end    = (m_region + 1) * m_frame_size;
+    if (bytes == 0 || offset + bytes > end) return {};
+    // Mapped again only when a flush() for drawing came in between.
+    if (!m_mapped && !map()) return {};
+
+    m_head = offset + bytes;
+    return {m_mapped + (offset - m_mapped_offset), offset, bytes};
+}
+
+auto stream::flush() -> void {
+    if (!m_mapped) return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    if (m_head > m_mapped_offset) glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, m_head - m_mapped_offset);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_mapped = nullptr;
+}
+
+// The rest of the region in one map, only what was handed out is flushed.
+auto stream::map() -> bool {
+    auto const end = (m_region + 1) * m_frame_size;
+    if (m_head >= end) return false;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_id);
+    m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, m_head, end - m_head,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_mapped_offset = m_head;
+    return m_mapped != nullptr;
+}
+
+auto stream::end_frame() -> void {
+    flush();
+    auto& fence = m_fences[m_region];
+    if (fence) glDeleteSync(GLsync(fence));
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+auto stream::create(uint32_t const& frame_size, uint32_t const& frames) -> ref<stream> {
+    return make_ref<stream>(frame_size, frames);
+}
+
 frame::frame() {
     glGenFramebuffers(1, &m_id);
     glBindFramebuffer(GL_FRAMEBUFFER, m_id);
 }
+frame::frame(int32_t const& width, int32_t const& height, uint32_t const& color) : frame() {
+    m_format = color;
+    resize(width, height);
+}
 frame::~frame() {
+    if (m_color) glDeleteTextures(1, &m_color);
+    if (m_depth) glDeleteRenderbuffers(1, &m_depth);
     glDeleteFramebuffers(1, &m_id);
 }
 
@@ -98,6 +222,38 @@ auto frame::unbind() const -> void {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+auto frame::resize(int32_t const& width, int32_t const& height) -> void {
+    if (m_color && width == m_width && height == m_height) return;
+    m_width  = width;
+    m_height = height;
+    if (!m_color) glGenTextures(1, &m_color);
+    if (!m_depth) glGenRenderbuffers(1, &m_depth);
+
+    glBindTexture(GL_TEXTURE_2D, m_color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GLint(m_format), width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_id);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "ERROR::FRAMEBUFFER: Framebuffer is not complete!\n";
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+auto frame::read(uint8_t* pixels) const -> void {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_id);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
 array::array() {
     glGenVertexArrays(1, &m_id);
     glBindVertexArray(m_id);
@@ -119,8 +275,9 @@ auto array::add_vertex_buffer(ref<vertex> const& vertex_buffer) -> void {
     auto stride = layout.get_stride();
 
     std::for_each(std::begin(layout), std::end(layout), [&](element const& e) {
-        auto size   = element::component_count(e.type);
-        auto offset = e.offset;
+        auto locations = element::location_count(e.type);
+        auto size      = element::component_count(e.type) / locations;
+        auto column    = element::shader_type_size(e.type) / locations;
         switch(e.type) {
             case shader::type::f32:
             case shader::type::vec2:
@@ -129,9 +286,13 @@ auto array::add_vertex_buffer(ref<vertex> const& vertex_buffer) -> void {
             case shader::type::mat2:
             case shader::type::mat3:
             case shader::type::mat4:
-                glVertexAttribPointer(m_vertex_buffer_index, size, GL_FLOAT, e.normalised ? GL_TRUE : GL_FALSE, stride, (void const*)(intptr_t)offset);
-                glEnableVertexAttribArray(m_vertex_buffer_index);
-                m_vertex_buffer_index++;
+                for (int32_t i = 0; i < locations; i++) {
+                    auto offset = e.offset + i * column;
+                    glVertexAttribPointer(m_vertex_buffer_index, size, GL_FLOAT, e.normalised ? GL_TRUE : GL_FALSE, stride, (void const*)(intptr_t)offset);
+                    glEnableVertexAttribArray(m_vertex_buffer_index);
+                    glVertexAttribDivisor(m_vertex_buffer_index, e.divisor);
+                    m_vertex_buffer_index++;
+                }
                 break;
             default: break;
         }
@@ -140,6 +301,26 @@ auto array::add_vertex_buffer(ref<vertex> const& vertex_buffer) -> void {
     m_vertex_buffers.push_back(vertex_buffer);
 }
 
+auto array::add_vertex_buffer(ref<vertex> const& vertex_buffer, std::span<attribute const> attributes,
+                              uint32_t const& stride) -> void {
+    glBindVertexArray(m_id);
+    vertex_buffer->bind();
+    for (auto const& a : attributes) {
+        auto column = a.size / a.locations;
+        for (int32_t i = 0; i < a.locations; i++) {
+            auto offset = (void const*)(intptr_t)(a.offset + i * column);
+            if (a.is_integer())
+                glVertexAttribIPointer(m_vertex_buffer_index, a.components, a.type, stride, offset);
+            else
+                glVertexAttribPointer(m_vertex_buffer_index, a.components, a.type, a.normalised ? GL_TRUE : GL_FALSE, stride, offset);
+            glEnableVertexAttribArray(m_vertex_buffer_index);
+            glVertexAttribDivisor(m_vertex_buffer_index, a.divisor);
+            m_vertex_buffer_index++;
+        }
+    }
+    m_vertex_buffers.push_back(vertex_buffer);
+}
+
 auto array::set_index_buffer(ref<index> const& index_buffer) -> void {
     glBindVertexArray(m_id);
     m_index_buffer = index_buffer;
@@ -3,9 +3,11 @@
 #include <string>
 #include <cstdint>
 #include <vector>
+#include <span>
 
 #include "luma.hpp"
 #include "shader.hpp"
+#include "format.hpp"
 
 namespace luma {
 
@@ -15,6 +17,7 @@ struct element {
     shader::type type;
     std::string  name;
     bool         normalised = false;
+    uint32_t     divisor    = 0;  // 0 per vertex, n advance every n instances
     uint32_t     offset     = 0;
 
     inline static auto shader_type_size(shader::type const& type) -> int32_t {
@@ -68,6 +71,16 @@ struct element {
             default: return 1;
         }
     }
+
+    // Matrices take one attribute location per column.
+    inline static auto location_count(shader::type const& type) -> int32_t {
+        switch(type) {
+            case shader::type::mat2: return 2;
+            case shader::type::mat3: return 3;
+            case shader::type::mat4: return 4;
+            default: return 1;
+        }
+    }
 };
 
 class layout {
@@ -97,18 +110,28 @@ class vertex {
   public:
     vertex(void const* vertices, uint32_t const& size);
     vertex(std::vector<mesh::vertex> const& vertices);
+    vertex(uint32_t const& size);
     ~vertex();
 
     auto get_layout() const -> layout const& { return m_layout; }
     auto set_layout(layout const& layout) -> void { m_layout = layout; }
+    auto size() const -> uint32_t { return m_size; }
+    auto get_id() const -> uint32_t { return m_id; }
     auto bind() const -> void;
+    // Overwrite bytes in place, the buffer keeps its size.
+    auto update(uint32_t const& offset, void const* data, uint32_t const& size) -> void;
+    // Replace the content, orphaning the old storage so the driver does not
+    // wait for draws still reading it. Grows the buffer when needed.
+    auto set_data(void const* data, uint32_t const& size) -> void;
 
     static auto create(void const* vertices, uint32_t const& size) -> ref<vertex>;
+    static auto create(uint32_t const& size) -> ref<vertex>;
   private:
     auto create_buffer() const -> uint32_t;
 
   private:
     uint32_t m_id;
+    uint32_t m_size;
     layout m_layout;
 };
 
@@ -120,6 +143,9 @@ class index {
 
     auto bind() const -> void;
     auto count() -> uint32_t { return m_count; }
+    auto get_id() const -> uint32_t { return m_id; }
+    // Overwrite count indices starting at index first.
+    auto update(uint32_t const& first, uint32_t const* indices, uint32_t const& count) -> void;
 
     static auto create(uint32_t const* indices, uint32_t const& count) -> ref<index>;
   private:
@@ -130,17 +156,80 @@ class index {
     uint32_t m_count;
 };
 
+// Ring buffer for per-frame dynamic data. The ring is split into one region
+// per frame in flight, each guarded by a fence, so writes go through
+// unsynchronized maps without the driver stalling on draws still in flight.
+// A region is mapped once per frame and allocations are sub-ranges of it.
+class stream {
+  public:
+    struct allocation {
+        void*    data   = nullptr;  // nullptr when the frame region is full
+        uint32_t offset = 0;        // byte offset into the buffer
+        uint32_t size   = 0;
+    };
+
+  public:
+    stream(uint32_t const& frame_size, uint32_t const& frames = 3);
+    ~stream();
+
+    auto id() const -> uint32_t { return m_id; }
+    auto frame_size() const -> uint32_t { return m_frame_size; }
+    auto used() const -> uint32_t { return m_head - m_region * m_frame_size; }
+    auto bind(uint32_t const& target) const -> void;
+
+    // Wait until the GPU is done with the next region and map it.
+    auto begin_frame() -> void;
+    // Pointer stays writable until flush(). An `alignment` of 0 is taken as 1.
+    auto allocate(uint32_t const& bytes, uint32_t const& alignment = 16) -> allocation;
+    // Unmap pending writes, required before drawing from the buffer. Later
+    // allocations in the frame map what is left of the region again.
+    auto flush() -> void;
+    // Fence the region so it is not reused before the GPU has read it.
+    auto end_frame() -> void;
+
+    static auto create(uint32_t const& frame_size, uint32_t const& frames = 3) -> ref<stream>;
+  private:
+    auto map() -> bool;
+
+  private:
+    uint32_t m_id;
+    uint32_t m_frame_size;
+    uint32_t m_frames;
+    uint32_t m_region = 0;
+    uint32_t m_head   = 0;
+    uint8_t* m_mapped = nullptr;    // the region from m_mapped_offset on
+    uint32_t m_mapped_offset = 0;
+    std::vector<void*> m_fences;
+};
+
 class frame {
   public:
     frame();
+    // Offscreen target with a colour texture, RGBA8 unless given, and a
+    // depth/stencil buffer.
+    frame(int32_t const& width, int32_t const& height, uint32_t const& color = GL_RGBA8);
     ~frame();
 
     auto get_id() const -> int32_t { return m_id; }
+    auto color() const -> uint32_t { return m_color; }
+    auto width() const -> int32_t { return m_width; }
+    auto height() const -> int32_t { return m_height; }
     auto bind() const -> void;
     auto unbind() const -> void;
 
+    // Reallocates the attachments only when the size changes.
+    auto resize(int32_t const& width, int32_t const& height) -> void;
+    // Blocking read of the colour attachment into width * height RGBA pixels,
+    // bottom row first. Float targets are clamped to 8 bits.
+    auto read(uint8_t* pixels) const -> void;
+
   private:
     uint32_t m_id;
+    uint32_t m_color  = 0;
+    uint32_t m_depth  = 0;
+    uint32_t m_format = GL_RGBA8;
+    int32_t  m_width  = 0;
+    int32_t  m_height = 0;
 };
 
 class array {
@@ -148,9 +237,16 @@ class array {
     array();
     ~array();
 
+    auto get_id() const -> uint32_t { return m_id; }
     auto bind() const -> void;
 
     auto add_vertex_buffer(ref<vertex> const& vertex_buffer) -> void;
+    auto add_vertex_buffer(ref<vertex> const& vertex_buffer, std::span<attribute const> attributes,
+                           uint32_t const& stride) -> void;
+    template <typename Vertex, usize N>
+    auto add_vertex_buffer(ref<vertex> const& vertex_buffer, format<Vertex, N> const& format) -> void {
+        add_vertex_buffer(vertex_buffer, format.attributes, format.stride);
+    }
     auto set_index_buffer(ref<index> const& index_buffer) -> void;
 
     static auto create() -> ref<array>;
@@ -0,0 +1,254 @@
+#include "capture.hpp"
+#include "buffer.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "glad/glad.h"
+#include "stb_image_write.h"
+
+namespace luma {
+
+// RGBA rows bottom first, as read back from GL, to planar 4:2:0 top first.
+// Full range BT.601, what C420jpeg in the y4m header declares.
+static auto rgba_to_yuv420(u8 const* rgba, int32_t const& width, int32_t const& height, u8* yuv) -> void {
+    auto const cw = (width + 1) / 2;
+    auto const ch = (height + 1) / 2;
+    auto luma_plane = yuv;
+    auto cb_plane   = yuv + usize(width) * usize(height);
+    auto cr_plane   = cb_plane + usize(cw) * usize(ch);
+    auto pixel = [&](int32_t x, int32_t y) -> u8 const* {
+        x = std::min(x, width - 1);
+        y = std::min(y, height - 1);
+        return rgba + (usize(height - 1 - y) * usize(width) + usize(x)) * 4;
+    };
+    auto clamp = [](f32 const& v) { return u8(std::clamp(v + 0.5f, 0.0f, 255.0f)); };
+
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            auto p = pixel(x, y);
+            luma_plane[usize(y) * usize(width) + usize(x)] = clamp(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+        }
+    }
+    for (int32_t y = 0; y < ch; y++) {
+        for (int32_t x = 0; x < cw; x++) {
+            f32 r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int32_t i = 0; i < 4; i++) {
+                auto p = pixel(x * 2 + (i & 1), y * 2 + (i >> 1));
+                r += p[0];
+                g += p[1];
+                b += p[2];
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            auto const index = usize(y) * usize(cw) + usize(x);
+            cb_plane[index] = clamp(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            cr_plane[index] = clamp(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+}
+
+capture::capture(std::filesystem::path const& path, format const& encoding, int32_t const& rate, usize const& slots)
+    : m_path(path), m_format(encoding), m_rate(std::max(rate, 1)), m_slots(std::max<usize>(slots, 2)) {
+    m_max_pending = std::max<usize>(thread_pool::shared().size() * 2, 4);
+    for (auto& s : m_slots) glGenBuffers(1, &s.pbo);
+
+    if (m_format == format::y4m) {
+        if (m_path.has_parent_path()) std::filesystem::create_directories(m_path.parent_path());
+        m_stream.open(m_path, std::ios::binary);
+        if (!m_stream) throw std::runtime_error("Failed to open capture file " + m_path.string());
+    } else {
+        std::filesystem::create_directories(m_path);
+    }
+}
+
+capture::~capture() {
+    finish();
+    for (auto& s : m_slots) glDeleteBuffers(1, &s.pbo);
+}
+
+auto capture::read(buffer::frame const& frame) -> void {
+    LUMA_PROFILE_FUNCTION();
+    poll();
+
+    auto const width  = frame.width();
+    auto const height = frame.height();
+    if (m_format == format::y4m) {
+        if (m_width == 0) {
+            m_width  = width;
+            m_height = height;
+        } else if (width != m_width || height != m_height) {
+            std::cerr << "ERROR::CAPTURE: y4m needs a fixed frame size, skipping "
+                      << width << 'x' << height << " frame\n";
+            return;
+        }
+    }
+
+    auto& s = m_slots[m_head];
+    if (s.fence) {
+        m_stalls++;
+        retrieve(s, true);
+    }
+
+    auto const size = usize(width) * usize(height) * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    if (size != s.size) glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(size), nullptr, GL_STREAM_READ);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, uint32_t(frame.get_id()));
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    s.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.width  = width;
+    s.height = height;
+    s.size   = size;
+    s.index  = m_frames++;
+    m_head = (m_head + 1) % m_slots.size();
+}
+
+auto capture::poll() -> void {
+    // Oldest first, fences signal in order so stop at the first pending one.
+    for (usize i = 0; i < m_slots.size(); i++) {
+        auto& s = m_slots[(m_head + i) % m_slots.size()];
+        if (s.fence && !retrieve(s, false)) break;
+    }
+}
+
+auto capture::finish() -> void {
+    for (usize i = 0; i < m_slots.size(); i++) {
+        auto& s = m_slots[(m_head + i) % m_slots.size()];
+        if (s.fence) retrieve(s, true);
+    }
+    std::unique_lock lock{m_mutex};
+    m_condition.wait(lock, [this] { return m_pending == 0; });
+    if (m_stream.is_open()) m_stream.flush();
+}
+
+auto capture::retrieve(slot& s, bool const& wait) -> bool {
+    auto const fence = GLsync(s.fence);
+    auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+    if (status == GL_TIMEOUT_EXPIRED) return false;
+
+    glDeleteSync(fence);
+    s.fence = nullptr;
+    if (status == GL_WAIT_FAILED) {
+        std::cerr << "ERROR::CAPTURE: Waiting on frame " << s.index << " failed\n";
+        if (m_format == format::y4m) write_y4m(s.index, {});
+        return true;
+    }
+
+    auto pixels = acquire(s.size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    auto mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(s.size), GL_MAP_READ_BIT);
+    if (mapped) std::memcpy(pixels.data(), mapped, s.size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    thread_pool::shared().submit([this, index = s.index, width = s.width, height = s.height,
+                                  pixels = std::move(pixels)]() mutable {
+        encode(index, width, height, std::move(pixels));
+    });
+    return true;
+}
+
+auto capture::encode(u64 const& index, int32_t const& width, int32_t const& height, std::vector<u8>&& pixels) -> void {
+    LUMA_PROFILE_FUNCTION();
+    auto const stride = usize(width) * 4;
+    auto const last   = pixels.data() + stride * usize(std::max(height - 1, 0));
+
+    if (m_format == format::y4m) {
+        auto const cw = usize(width + 1) / 2;
+        auto const ch = usize(height + 1) / 2;
+        std::vector<u8> yuv(usize(width) * usize(height) + cw * ch * 2);
+        rgba_to_yuv420(pixels.data(), width, height, yuv.data());
+        write_y4m(index, std::move(yuv));
+    } else {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%06llu.%s", static_cast<unsigned long long>(index),
+                      m_format == format::png ? "png" : "raw");
+        auto const filename = (m_path / name).string();
+
+        auto is_written = false;
+        if (m_format == format::png) {
+            is_written = stbi_write_png(filename.c_str(), width, height, 4, last, -int32_t(stride)) != 0;
+        } else {
+            std::ofstream file{filename, std::ios::binary};
+            for (int32_t y = 0; y < height && file; y++)
+                file.write(reinterpret_cast<char const*>(last - stride * usize(y)), isize(stride));
+            is_written = bool(file);
+        }
+        if (!is_written) std::cerr << "ERROR::CAPTURE: Failed to write " << filename << '\n';
+    }
+    release(std::move(pixels));
+}
+
+auto capture::write_y4m(u64 const& index, std::vector<u8>&& frame) -> void {
+    std::unique_lock lock{m_mutex};
+    m_out_of_order.emplace(index, std::move(frame));
+    // One writer at a time keeps the order, the others hand their frame over
+    // and return. The file is written unlocked so acquire() never waits on it.
+    if (m_is_writing) return;
+    m_is_writing = true;
+
+    std::vector<std::vector<u8>> ready;
+    while (true) {
+        while (!m_out_of_order.empty() && std::begin(m_out_of_order)->first == m_next_write + ready.size()) {
+            auto it = std::begin(m_out_of_order);
+            ready.push_back(std::move(it->second));
+            m_out_of_order.erase(it);
+        }
+        if (ready.empty()) break;
+        auto const first = m_next_write;
+        lock.unlock();
+
+        if (first == 0)
+            m_stream << "YUV4MPEG2 W" << m_width << " H" << m_height << " F" << m_rate << ":1 Ip A1:1 C420jpeg\n";
+        for (auto const& yuv : ready) {
+            // Empty for a frame that failed to read back, skipped.
+            if (yuv.empty()) continue;
+            m_stream << "FRAME\n";
+            m_stream.write(reinterpret_cast<char const*>(yuv.data()), isize(yuv.size()));
+        }
+
+        lock.lock();
+        m_next_write += ready.size();
+        ready.clear();
+    }
+    m_is_writing = false;
+}
+
+auto capture::acquire(usize const& size) -> std::vector<u8> {
+    std::unique_lock lock{m_mutex};
+    if (m_pending >= m_max_pending) {
+        // Encoders are behind, wait rather than let memory grow unbounded.
+        m_stalls++;
+        m_condition.wait(lock, [this] { return m_pending < m_max_pending; });
+    }
+    m_pending++;
+
+    std::vector<u8> buffer;
+    if (!m_free.empty()) {
+        buffer = std::move(m_free.back());
+        m_free.pop_back();
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+auto capture::release(std::vector<u8>&& buffer) -> void {
+    std::lock_guard lock{m_mutex};
+    m_free.push_back(std::move(buffer));
+    m_pending--;
+    m_condition.notify_all();
+}
+
+}
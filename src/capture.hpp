@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// Records frames without stalling the GPU. read() copies the colour
+// attachment into one of a ring of pixel pack buffers and fences it, the
+// pixels are mapped once the fence has signalled, a few frames later, and
+// handed to the shared thread_pool to be encoded and written.
+//
+//   png, raw: `path` is a directory, one numbered file per frame.
+//   y4m:      `path` is the file, frames are converted to 4:2:0 and appended
+//             in order however the workers finish.
+class capture {
+  public:
+    enum class format : uint8_t {
+        png,
+        raw,
+        y4m,
+    };
+
+  public:
+    capture(std::filesystem::path const& path, format const& encoding, int32_t const& rate = 60,
+            usize const& slots = 3);
+    ~capture();
+    capture(capture const&) = delete;
+    auto operator=(capture const&) -> capture& = delete;
+
+    // Needs the GL context current. Waits only if the ring is full of
+    // unfinished reads, i.e. the GPU is more than `slots` frames behind.
+    auto read(buffer::frame const& frame) -> void;
+    // Hand over every read whose fence has signalled, never blocks.
+    auto poll() -> void;
+    // Wait for all reads and encodes, the output is complete afterwards.
+    auto finish() -> void;
+
+    auto frames() const -> u64 { return m_frames; }
+    // Reads that had to wait on their fence or on the encoders.
+    auto stalls() const -> u64 { return m_stalls; }
+
+  private:
+    struct slot {
+        uint32_t pbo    = 0;
+        void*    fence  = nullptr;
+        int32_t  width  = 0;
+        int32_t  height = 0;
+        usize    size   = 0;
+        u64      index  = 0;
+    };
+
+    auto retrieve(slot& slot, bool const& wait) -> bool;
+    auto encode(u64 const& index, int32_t const& width, int32_t const& height, std::vector<u8>&& pixels) -> void;
+    auto write_y4m(u64 const& index, std::vector<u8>&& frame) -> void;
+    auto acquire(usize const& size) -> std::vector<u8>;
+    auto release(std::vector<u8>&& buffer) -> void;
+
+  private:
+    std::filesystem::path m_path;
+    format   m_format;
+    int32_t  m_rate;
+    std::vector<slot> m_slots;
+    usize    m_head   = 0;
+    u64      m_frames = 0;
+    u64      m_stalls = 0;
+
+    // Shared with the encoders.
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    std::vector<std::vector<u8>> m_free;
+    usize    m_pending = 0;
+    usize    m_max_pending;
+
+    // y4m output, frames are appended strictly in index order.
+    std::ofstream m_stream;
+    std::map<u64, std::vector<u8>> m_out_of_order;
+    u64      m_next_write = 0;
+    bool     m_is_writing = false;
+    int32_t  m_width  = 0;
+    int32_t  m_height = 0;
+};
+
+}
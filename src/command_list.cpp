@@ -0,0 +1,110 @@
+#include "command_list.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace luma {
+
+linear_allocator::linear_allocator(usize const& block_size) : m_block_size(block_size) {}
+
+auto linear_allocator::allocate(usize const& size, usize const& alignment) -> void* {
+    while (m_block < m_blocks.size()) {
+        auto base   = reinterpret_cast<uintptr_t>(m_blocks[m_block].get());
+        auto offset = (base + m_offset + alignment - 1) / alignment * alignment - base;
+        if (offset + size <= m_sizes[m_block]) {
+            m_offset = offset + size;
+            m_used  += size;
+            return m_blocks[m_block].get() + offset;
+        }
+        m_block++;
+        m_offset = 0;
+    }
+
+    auto block_size = std::max(m_block_size, size + alignment);
+    m_blocks.push_back(make_local<u8[]>(block_size));
+    m_sizes.push_back(block_size);
+    m_block  = m_blocks.size() - 1;
+    m_offset = 0;
+    return allocate(size, alignment);
+}
+
+auto linear_allocator::reset() -> void {
+    m_block  = 0;
+    m_offset = 0;
+    m_used   = 0;
+}
+
+command_list::command_list(usize const& capacity) {
+    m_commands.reserve(capacity);
+}
+
+auto command_list::submit(render_queue const& queue, uint8_t const& pass, render_queue::blend const& blend,
+                          shader& program, uint32_t const& texture, mesh::primitive const& primitive,
+                          glm::mat4 const& model) -> void {
+    submit(render_queue::make_command(pass, blend, program, texture, primitive, model,
+                                      queue.depth(glm::vec3(model[3]))));
+}
+
+auto command_list::submit(render_queue::command const& command) -> void {
+    m_commands.push_back(command);
+    m_tail = nullptr;
+}
+
+auto command_list::uniform(char const* name, shader::type const& type, void const* data,
+                           usize const& size, uint32_t const& count) -> void {
+    if (m_commands.empty()) return;
+    auto payload = m_payload.allocate(size);
+    std::memcpy(payload, data, size);
+
+    auto record = static_cast<render_queue::uniform*>(m_payload.allocate(sizeof(render_queue::uniform),
+                                                                         alignof(render_queue::uniform)));
+    *record = {name, type, count, payload, nullptr};
+    if (m_tail) m_tail->next = record;
+    else m_commands.back().uniforms = record;
+    m_tail = record;
+}
+
+auto command_list::reset() -> void {
+    m_commands.clear();
+    m_payload.reset();
+    m_tail = nullptr;
+}
+
+static std::atomic<u64> command_buffer_serial{0};
+
+command_buffer::command_buffer() : m_serial(++command_buffer_serial) {}
+
+auto command_buffer::local() -> command_list& {
+    // Cache the lookup per thread, the serial guards against a new buffer
+    // reusing the address of a destroyed one.
+    struct cache {
+        u64           serial = 0;
+        command_list* list   = nullptr;
+    };
+    thread_local cache cached{};
+    if (cached.serial == m_serial) return *cached.list;
+
+    std::lock_guard lock{m_mutex};
+    auto const id = std::this_thread::get_id();
+    auto it = std::find_if(std::begin(m_lists), std::end(m_lists), [&](auto const& pair) {
+        return pair.first == id;
+    });
+    if (it == std::end(m_lists)) {
+        m_lists.push_back({id, make_ref<command_list>()});
+        it = std::prev(std::end(m_lists));
+    }
+    cached = {m_serial, it->second.get()};
+    return *cached.list;
+}
+
+auto command_buffer::reset() -> void {
+    std::lock_guard lock{m_mutex};
+    for (auto& [_, list] : m_lists) list->reset();
+}
+
+auto command_buffer::submit(render_queue& queue) const -> void {
+    std::lock_guard lock{m_mutex};
+    for (auto const& [_, list] : m_lists) queue.submit(*list);
+}
+
+}
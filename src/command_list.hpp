@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <mutex>
+#include <thread>
+
+#include "luma.hpp"
+#include "render_queue.hpp"
+
+namespace luma {
+
+// Bump allocator over fixed size blocks. Pointers stay valid until reset(),
+// which rewinds without giving the blocks back.
+class linear_allocator {
+  public:
+    linear_allocator(usize const& block_size = 64 * 1024);
+    ~linear_allocator() = default;
+
+    auto allocate(usize const& size, usize const& alignment = alignof(std::max_align_t)) -> void*;
+    auto reset() -> void;
+    auto used() const -> usize { return m_used; }
+
+  private:
+    usize m_block_size;
+    usize m_block  = 0;
+    usize m_offset = 0;
+    usize m_used   = 0;
+    std::vector<local<u8[]>> m_blocks;
+    std::vector<usize>       m_sizes;
+};
+
+// Draw packets recorded by one thread. Recording touches no GL state, the
+// list is merged into a render_queue and replayed on the GL thread.
+class command_list {
+  public:
+    command_list(usize const& capacity = 256);
+    ~command_list() = default;
+
+    auto submit(render_queue const& queue, uint8_t const& pass, render_queue::blend const& blend,
+                shader& program, uint32_t const& texture, mesh::primitive const& primitive,
+                glm::mat4 const& model) -> void;
+    auto submit(render_queue::command const& command) -> void;
+
+    // Attach a uniform to the last submitted packet, the data is copied.
+    auto uniform(char const* name, shader::type const& type, void const* data,
+                 usize const& size, uint32_t const& count = 1) -> void;
+    template <typename T>
+    auto uniform(char const* name, shader::type const& type, T const& value) -> void {
+        uniform(name, type, &value, sizeof(T));
+    }
+
+    auto commands() const -> std::vector<render_queue::command> const& { return m_commands; }
+    auto reset() -> void;
+
+  private:
+    std::vector<render_queue::command> m_commands;
+    linear_allocator                   m_payload;
+    render_queue::uniform*             m_tail = nullptr;
+};
+
+// One command_list per recording thread, handed out by local(). Lists are
+// kept between frames so steady state recording does not allocate.
+class command_buffer {
+  public:
+    command_buffer();
+    ~command_buffer() = default;
+
+    auto local() -> command_list&;
+    auto reset() -> void;
+    auto submit(render_queue& queue) const -> void;
+
+  private:
+    u64 m_serial;
+    mutable std::mutex m_mutex;
+    std::vector<std::pair<std::thread::id, ref<command_list>>> m_lists;
+};
+
+}
@@ -0,0 +1,76 @@
+#include "filmstrip.hpp"
+#include "resample.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace luma {
+
+static auto distance(usize const& a, usize const& b) -> usize {
+    return a > b ? a - b : b - a;
+}
+
+filmstrip::filmstrip(int32_t const& size, int32_t const& pages)
+    : m_size(std::max(size, 1)), m_atlas(1024, 4, pages), m_batch(256, batch::source::array) {}
+
+auto filmstrip::add(usize const& index, image const& decoded, usize const& cursor) -> void {
+    LUMA_PROFILE_SCOPE("filmstrip::add");
+    if (m_thumbnails.contains(index) || !decoded.buffer()) return;
+
+    auto level = &decoded;
+    for (auto const& mip : decoded.mips())
+        if (std::max(mip->width(), mip->height()) >= m_size) level = mip.get();
+    auto const size   = resample::fit(level->width(), level->height(), m_size);
+    auto const scaled = resample::resize(level->buffer(), level->type(), level->width(), level->height(),
+                                         level->channels(), size.width, size.height, resample::filter::mitchell);
+    std::vector<u8> pixels(usize(size.width) * usize(size.height) * 4);
+    resample::encode(scaled, 4, pixels.data());
+
+    auto id = m_atlas.insert(pixels.data(), size.width, size.height, 4);
+    while (!id && !m_thumbnails.empty()) {
+        auto furthest = std::max_element(std::begin(m_thumbnails), std::end(m_thumbnails),
+                                         [&](auto const& a, auto const& b) {
+                                             return distance(a.first, cursor) < distance(b.first, cursor);
+                                         });
+        // The new one would be the first to go.
+        if (distance(furthest->first, cursor) <= distance(index, cursor)) return;
+        m_atlas.remove(furthest->second);
+        m_thumbnails.erase(furthest);
+        id = m_atlas.insert(pixels.data(), size.width, size.height, 4);
+    }
+    if (id) m_thumbnails.emplace(index, *id);
+}
+
+auto filmstrip::render(usize const& cursor, usize const& count, int32_t const& width, int32_t const& height) -> void {
+    LUMA_PROFILE_SCOPE("filmstrip::render");
+    if (m_thumbnails.empty() || count == 0) return;
+    auto const margin  = std::max(m_size / 12, 2);
+    auto const stride  = m_size + margin;
+    auto const visible = std::min(count, usize(std::max(width / stride, 1)));
+    auto const first   = std::min(cursor - std::min(cursor, visible / 2), count - visible);
+    auto const left    = f32(width - int32_t(visible) * stride + margin) * 0.5f;
+
+    m_batch.clear();
+    for (usize i = 0; i < visible; i++) {
+        auto it = m_thumbnails.find(first + i);
+        if (it == std::end(m_thumbnails)) continue;
+        auto const& region = m_atlas.get(it->second);
+        // The plane spans -1 to 1, scaled by half the thumbnail's size.
+        glm::vec3 const center{left + f32(i * usize(stride)) + f32(m_size) * 0.5f, f32(margin + m_size / 2), 0.0f};
+        batch::instance instance{};
+        instance.model = glm::scale(glm::translate(glm::mat4{1.0f}, center),
+                                    {f32(region.width) * 0.5f, f32(region.height) * 0.5f, 1.0f});
+        instance.tint  = first + i == cursor ? glm::vec4{1.0f} : glm::vec4{0.55f, 0.55f, 0.55f, 1.0f};
+        instance.atlas = region.uv;
+        instance.layer = f32(region.page);
+        m_batch.add(instance);
+    }
+
+    m_atlas.bind(0);
+    m_batch.render(glm::mat4{1.0f}, glm::ortho(0.0f, f32(width), 0.0f, f32(height), -1.0f, 1.0f));
+}
+
+}
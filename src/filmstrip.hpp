@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "luma.hpp"
+#include "atlas.hpp"
+#include "batch.hpp"
+#include "image.hpp"
+
+namespace luma {
+
+// Thumbnails of an image list along the bottom of the screen, the current
+// one at full brightness. A thumbnail is resized from the smallest mip of a
+// decoded image that still covers `size` and packed into an atlas, the whole
+// strip is then a single instanced draw from the texture array. Once the
+// atlas is full the thumbnails furthest from the cursor make room.
+//
+// Uses GL, call from the thread owning the context.
+class filmstrip {
+  public:
+    filmstrip(int32_t const& size = 96, int32_t const& pages = 2);
+    ~filmstrip() = default;
+    filmstrip(filmstrip const&) = delete;
+    auto operator=(filmstrip const&) -> filmstrip& = delete;
+
+    // Float images are tone clipped to 8-bit.
+    auto add(usize const& index, image const& decoded, usize const& cursor) -> void;
+    auto contains(usize const& index) const -> bool { return m_thumbnails.contains(index); }
+    auto size() const -> usize { return m_thumbnails.size(); }
+
+    // Drawn over the bound framebuffer, `width` by `height` pixels, as many
+    // around `cursor` as fit in a row.
+    auto render(usize const& cursor, usize const& count, int32_t const& width, int32_t const& height) -> void;
+
+  private:
+    int32_t m_size;
+    atlas   m_atlas;
+    batch   m_batch;
+    std::unordered_map<usize, atlas::handle> m_thumbnails;
+};
+
+}
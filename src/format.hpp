@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include "luma.hpp"
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+namespace luma {
+
+namespace buffer {
+
+// Compile time counterpart of buffer::layout. A format is derived from the
+// vertex struct itself, so stride and offsets can not drift from the data.
+struct attribute {
+    uint32_t type;        // GL component type
+    int32_t  components;  // per location
+    int32_t  locations;   // matrices take one location per column
+    uint32_t size;        // bytes
+    uint32_t offset;
+    bool     normalised = false;
+    uint32_t divisor    = 0;
+
+    constexpr auto is_integer() const -> bool {
+        return !normalised && type != GL_FLOAT && type != GL_HALF_FLOAT && type != GL_DOUBLE;
+    }
+};
+
+template <typename T> struct attribute_traits;
+
+template <uint32_t Type, typename Component, int32_t Components, int32_t Locations = 1>
+struct attribute_info {
+    using component_type = Component;
+    static constexpr uint32_t type       = Type;
+    static constexpr int32_t  components = Components;
+    static constexpr int32_t  locations  = Locations;
+};
+
+template <> struct attribute_traits<f32>       : attribute_info<GL_FLOAT, f32, 1> {};
+template <> struct attribute_traits<glm::vec2> : attribute_info<GL_FLOAT, f32, 2> {};
+template <> struct attribute_traits<glm::vec3> : attribute_info<GL_FLOAT, f32, 3> {};
+template <> struct attribute_traits<glm::vec4> : attribute_info<GL_FLOAT, f32, 4> {};
+template <> struct attribute_traits<glm::mat3> : attribute_info<GL_FLOAT, f32, 3, 3> {};
+template <> struct attribute_traits<glm::mat4> : attribute_info<GL_FLOAT, f32, 4, 4> {};
+template <> struct attribute_traits<i32>       : attribute_info<GL_INT, i32, 1> {};
+template <> struct attribute_traits<u32>       : attribute_info<GL_UNSIGNED_INT, u32, 1> {};
+template <> struct attribute_traits<glm::ivec2>: attribute_info<GL_INT, i32, 2> {};
+template <> struct attribute_traits<glm::ivec4>: attribute_info<GL_INT, i32, 4> {};
+
+template <typename T>
+constexpr auto make_attribute(uint32_t const& offset, bool const& normalised = false,
+                              uint32_t const& divisor = 0) -> attribute {
+    using traits = attribute_traits<T>;
+    static_assert(sizeof(T) == sizeof(typename traits::component_type) * traits::components * traits::locations,
+                  "attribute type is padded, GL would read it with the wrong stride");
+    return {traits::type, traits::components, traits::locations, uint32_t(sizeof(T)), offset, normalised, divisor};
+}
+
+// LUMA_ATTRIBUTE(vertex, member[, normalised[, divisor]])
+#define LUMA_ATTRIBUTE(vertex, member, ...) \
+    ::luma::buffer::make_attribute<decltype(vertex::member)>(offsetof(vertex, member) __VA_OPT__(,) __VA_ARGS__)
+
+template <typename Vertex, usize N>
+struct format {
+    using vertex_type = Vertex;
+    static constexpr uint32_t stride = sizeof(Vertex);
+
+    std::array<attribute, N> attributes;
+
+    constexpr auto locations() const -> int32_t {
+        int32_t count = 0;
+        for (auto const& a : attributes) count += a.locations;
+        return count;
+    }
+    constexpr auto is_in_bounds() const -> bool {
+        for (auto const& a : attributes)
+            if (a.offset + a.size > stride) return false;
+        return true;
+    }
+    // Attributes listed in member order and covering the struct without gaps.
+    constexpr auto is_packed() const -> bool {
+        uint32_t offset = 0;
+        for (auto const& a : attributes) {
+            if (a.offset != offset) return false;
+            offset += a.size;
+        }
+        return offset == stride;
+    }
+};
+
+template <typename Vertex, typename... Attributes>
+constexpr auto make_format(Attributes const&... attributes) -> format<Vertex, sizeof...(Attributes)> {
+    return {{attributes...}};
+}
+
+}
+
+}
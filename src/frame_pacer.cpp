@@ -0,0 +1,145 @@
+#include "frame_pacer.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "GLFW/glfw3.h"
+#include "imgui.h"
+
+namespace luma {
+
+using seconds = std::chrono::duration<f64>;
+
+// Sorted copy of the newest `count` samples of a ring.
+static auto sorted(std::vector<f32> const& ring, usize const& head, usize const& count) -> std::vector<f32> {
+    std::vector<f32> samples(count);
+    auto const first = (head + ring.size() - count) % ring.size();
+    for (usize i = 0; i < count; i++) samples[i] = ring[(first + i) % ring.size()];
+    std::sort(std::begin(samples), std::end(samples));
+    return samples;
+}
+
+static auto percentile(std::vector<f32> const& sorted, f64 const& p) -> f64 {
+    if (sorted.empty()) return 0.0;
+    auto const rank = usize(std::max(std::ceil(p * f64(sorted.size())), 1.0)) - 1;
+    return sorted[rank];
+}
+
+frame_pacer::frame_pacer(mode const& pacing, f64 const& rate, usize const& history)
+    : m_mode(pacing), m_rate(rate), m_frame_times(std::max<usize>(history, 1)),
+      m_work_times(std::max<usize>(history, 1)) {}
+
+auto frame_pacer::set_mode(mode const& pacing, f64 const& rate) -> void {
+    m_mode = pacing;
+    if (rate > 0.0) m_rate = rate;
+    glfwSwapInterval(m_mode == mode::vsync ? 1 : 0);
+    m_deadline = clock::now();
+}
+
+auto frame_pacer::set_refresh_rate(f64 const& rate) -> void {
+    if (rate > 0.0) m_refresh_rate = rate;
+}
+
+auto frame_pacer::wait() -> void {
+    LUMA_PROFILE_SCOPE("frame_pacer::wait");
+    auto const now = clock::now();
+    if (m_mode == mode::fixed) {
+        // Step the deadline instead of restarting it from now, so the rate
+        // doesn't drift. A frame that ran over restarts the schedule rather
+        // than rushing the next ones to catch up.
+        m_deadline += std::chrono::duration_cast<clock::duration>(seconds{1.0 / m_rate});
+        if (m_deadline < now) m_deadline = now;
+        sleep_until(m_deadline);
+    } else if (m_mode == mode::vsync && m_is_late_input && m_count > 0) {
+        // The swap just returned on a blank, the next one is a refresh away.
+        auto const margin = 1e-3;
+        auto const slack  = 1.0 / m_refresh_rate - work_estimate() - margin;
+        if (slack > 0.0) sleep_until(now + std::chrono::duration_cast<clock::duration>(seconds{slack}));
+    }
+}
+
+auto frame_pacer::sleep_until(clock::time_point const& deadline) -> void {
+    auto const wake = deadline - std::chrono::duration_cast<clock::duration>(seconds{m_spin});
+    if (wake > clock::now()) {
+        std::this_thread::sleep_until(wake);
+        // Widen the spin window as soon as the OS oversleeps, narrow it slowly.
+        auto const overshoot = seconds{clock::now() - wake}.count();
+        m_spin = std::clamp(std::max(m_spin * 0.99, overshoot * 1.25), 0.2e-3, 4e-3);
+    }
+    while (clock::now() < deadline) std::this_thread::yield();
+}
+
+auto frame_pacer::begin_frame() -> f64 {
+    auto const now = clock::now();
+    auto const dt  = m_frames > 0 ? seconds{now - m_frame_start}.count() : 0.0;
+    m_frame_start = now;
+    m_frames++;
+    if (dt <= 0.0) return dt;
+
+    // Compared against the average before this frame is folded in.
+    m_is_stutter = m_count >= 8 && dt > m_average * m_threshold;
+    if (m_is_stutter) m_stutters++;
+    m_average = m_count > 0 ? m_average + (dt - m_average) * 0.1 : dt;
+
+    m_frame_times[m_head] = f32(dt * 1e3);
+    m_work_times[m_head]  = 0.0f;
+    m_head  = (m_head + 1) % m_frame_times.size();
+    m_count = std::min(m_count + 1, m_frame_times.size());
+    return dt;
+}
+
+auto frame_pacer::end_frame() -> void {
+    if (m_count == 0) return;
+    auto const work = seconds{clock::now() - m_frame_start}.count();
+    m_work_times[(m_head + m_work_times.size() - 1) % m_work_times.size()] = f32(work * 1e3);
+}
+
+auto frame_pacer::work_estimate() const -> f64 {
+    return percentile(sorted(m_work_times, m_head, m_count), 0.95) * 1e-3;
+}
+
+auto frame_pacer::statistics() const -> stats {
+    auto const samples = sorted(m_frame_times, m_head, m_count);
+    stats result{};
+    result.stutters = m_stutters;
+    result.samples  = samples.size();
+    if (samples.empty()) return result;
+
+    for (auto const& sample : samples) result.avg += sample;
+    result.avg /= f64(samples.size());
+    result.p50 = percentile(samples, 0.50);
+    result.p95 = percentile(samples, 0.95);
+    result.p99 = percentile(samples, 0.99);
+    result.max = samples.back();
+    return result;
+}
+
+auto frame_pacer::history() const -> std::vector<f32> {
+    std::vector<f32> result(m_count);
+    auto const first = (m_head + m_frame_times.size() - m_count) % m_frame_times.size();
+    for (usize i = 0; i < m_count; i++) result[i] = m_frame_times[(first + i) % m_frame_times.size()];
+    return result;
+}
+
+auto frame_pacer::imgui() -> void {
+    ImGui::Begin("frame pacing");
+    char const* modes[] = {"vsync", "uncapped", "fixed"};
+    auto current = int32_t(m_mode);
+    auto rate    = int32_t(m_rate);
+    auto changed = ImGui::Combo("mode", &current, modes, 3);
+    if (mode(current) == mode::fixed) changed |= ImGui::SliderInt("rate", &rate, 24, 240);
+    if (changed) set_mode(mode(current), f64(rate));
+    ImGui::Checkbox("late input", &m_is_late_input);
+
+    auto const s = statistics();
+    auto const frames = history();
+    ImGui::PlotLines("frame ms", frames.data(), int32_t(frames.size()), 0, nullptr,
+                     0.0f, float(std::max(s.max, 1.0)), ImVec2(0, 60));
+    ImGui::Text("avg %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", s.avg, s.p50, s.p95, s.p99, s.max);
+    ImGui::Text("stutters: %zu", s.stutters);
+    ImGui::End();
+}
+
+}
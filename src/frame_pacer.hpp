@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// Decides when the next frame starts and keeps a history of frame times.
+//
+//   vsync:    swap interval 1, the swap blocks until the next vertical blank.
+//   uncapped: swap interval 0, frames start as soon as the last one is done.
+//   fixed:    swap interval 0, wait() holds frames to a fixed rate.
+//
+// Waiting sleeps until shortly before the deadline and spins the rest, the
+// spin window follows how much the OS has been oversleeping.
+class frame_pacer {
+  public:
+    enum class mode : uint8_t {
+        vsync,
+        uncapped,
+        fixed,
+    };
+
+    struct stats {
+        f64   avg;      // milliseconds
+        f64   p50;
+        f64   p95;
+        f64   p99;
+        f64   max;
+        usize stutters;
+        usize samples;
+    };
+
+  public:
+    frame_pacer(mode const& pacing = mode::vsync, f64 const& rate = 60.0, usize const& history = 240);
+    ~frame_pacer() = default;
+
+    // Needs the GL context current, the swap interval is set here.
+    auto set_mode(mode const& pacing, f64 const& rate = 0.0) -> void;
+    auto get_mode() const -> mode { return m_mode; }
+    auto rate() const -> f64 { return m_rate; }
+
+    // Refresh rate of the display, used to place the late input wait in vsync.
+    auto set_refresh_rate(f64 const& rate) -> void;
+
+    // Delay input sampling in vsync mode: wait() sleeps through the part of
+    // the refresh the last frames didn't need, so the frame is built from
+    // fresher input. Too tight a margin misses the blank, leave it off when
+    // frame times vary a lot.
+    auto set_late_input(bool const& enabled) -> void { m_is_late_input = enabled; }
+    auto is_late_input() const -> bool { return m_is_late_input; }
+
+    // Call order per frame: wait(), sample input, begin_frame(), build the
+    // frame, end_frame(), swap.
+    auto wait() -> void;
+    auto begin_frame() -> f64;      // seconds since the last frame started
+    auto end_frame() -> void;
+
+    // A frame taking more than `threshold` times the running average.
+    auto is_stutter() const -> bool { return m_is_stutter; }
+    auto statistics() const -> stats;
+    auto history() const -> std::vector<f32>;
+
+    auto imgui() -> void;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    auto sleep_until(clock::time_point const& deadline) -> void;
+    auto work_estimate() const -> f64;
+
+  private:
+    mode  m_mode;
+    f64   m_rate;
+    f64   m_refresh_rate  = 60.0;
+    bool  m_is_late_input = false;
+
+    clock::time_point m_frame_start{};
+    clock::time_point m_deadline{};
+    f64   m_spin    = 1e-3;     // seconds spun before a deadline
+    f64   m_average = 0.0;      // seconds, exponential moving average
+    f64   m_threshold  = 1.5;
+    bool  m_is_stutter = false;
+    usize m_stutters   = 0;
+    usize m_frames     = 0;
+
+    std::vector<f32> m_frame_times;   // milliseconds, ring
+    std::vector<f32> m_work_times;    // milliseconds, ring
+    usize m_head  = 0;
+    usize m_count = 0;
+};
+
+}
@@ -0,0 +1,209 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "glad/glad.h"
+#include "imgui.h"
+
+namespace luma {
+
+static auto summarise(std::vector<f32> const& history, usize const& head, usize const& count) -> gpu_profiler::stats {
+    if (count == 0) return {};
+    std::vector<f32> samples(count);
+    auto const first = (head + history.size() - count) % history.size();
+    for (usize i = 0; i < count; i++) samples[i] = history[(first + i) % history.size()];
+
+    gpu_profiler::stats result{};
+    result.last    = samples.back();
+    result.samples = count;
+    result.min     = *std::min_element(std::begin(samples), std::end(samples));
+    for (auto const& sample : samples) result.avg += sample;
+    result.avg /= f64(count);
+
+    auto const rank = usize(std::ceil(0.99 * f64(count))) - 1;
+    std::nth_element(std::begin(samples), std::begin(samples) + isize(rank), std::end(samples));
+    result.p99 = samples[rank];
+    return result;
+}
+
+gpu_profiler::gpu_profiler(usize const& frames, usize const& history)
+    : m_slots(std::max<usize>(frames, 2)), m_history(std::max<usize>(history, 1)) {}
+
+gpu_profiler::~gpu_profiler() {
+    for (auto& slot : m_slots)
+        if (!slot.queries.empty()) glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+}
+
+auto gpu_profiler::begin_frame() -> void {
+    auto& slot = m_slots[m_frame % m_slots.size()];
+    collect(slot);
+    slot.records.clear();
+    slot.used = 0;
+    m_stack.clear();
+    m_is_recording = true;
+}
+
+auto gpu_profiler::end_frame() -> void {
+    if (!m_is_recording) return;
+    if (!m_stack.empty()) {
+        std::cerr << "ERROR::GPU_PROFILER: " << m_stack.size() << " scope(s) left open at end of frame\n";
+        m_stack.clear();
+    }
+    m_is_recording = false;
+    m_frame++;
+}
+
+auto gpu_profiler::begin(char const* name) -> void {
+    if (!m_is_recording) return;
+    auto& slot = m_slots[m_frame % m_slots.size()];
+    auto const id = find(name);
+    m_timings[id].depth = u32(m_stack.size());
+
+    record rec{id, u32(m_stack.size()), query(slot), max::u32};
+    glQueryCounter(slot.queries[rec.first], GL_TIMESTAMP);
+    slot.records.push_back(rec);
+    m_stack.push_back(slot.records.size() - 1);
+}
+
+auto gpu_profiler::end() -> void {
+    if (!m_is_recording || m_stack.empty()) return;
+    auto& slot = m_slots[m_frame % m_slots.size()];
+    auto& rec  = slot.records[m_stack.back()];
+    rec.last = query(slot);
+    glQueryCounter(slot.queries[rec.last], GL_TIMESTAMP);
+    m_stack.pop_back();
+}
+
+auto gpu_profiler::query(slot& slot) -> u32 {
+    if (slot.used == slot.queries.size()) {
+        u32 id = 0;
+        glGenQueries(1, &id);
+        slot.queries.push_back(id);
+    }
+    return slot.used++;
+}
+
+auto gpu_profiler::collect(slot& slot) -> void {
+    if (slot.records.empty()) return;
+
+    // Queries complete in order, if the last one is ready all of them are.
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        m_dropped++;
+        return;
+    }
+
+    // A scope hit several times in one frame counts as one sample.
+    std::vector<f64> totals(m_timings.size(), -1.0);
+    for (auto const& rec : slot.records) {
+        if (rec.last == max::u32) continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[rec.first], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[rec.last],  GL_QUERY_RESULT, &end);
+        auto& total = totals[rec.timing];
+        total = std::max(total, 0.0) + f64(end - begin) * 1e-6;
+    }
+
+    for (usize i = 0; i < totals.size(); i++) {
+        if (totals[i] < 0.0) continue;
+        auto& t = m_timings[i];
+        t.history[t.head] = f32(totals[i]);
+        t.head  = (t.head + 1) % t.history.size();
+        t.count = std::min(t.count + 1, t.history.size());
+    }
+}
+
+auto gpu_profiler::find(char const* name) -> u32 {
+    auto it = m_index.find(name);
+    if (it != std::end(m_index)) return it->second;
+
+    auto const id = u32(m_timings.size());
+    m_timings.push_back({name, 0, std::vector<f32>(m_history), 0, 0});
+    m_index.emplace(name, id);
+    return id;
+}
+
+auto gpu_profiler::names() const -> std::vector<std::string> {
+    std::vector<std::string> result;
+    result.reserve(m_timings.size());
+    for (auto const& t : m_timings) result.push_back(t.name);
+    return result;
+}
+
+auto gpu_profiler::statistics(std::string const& name) const -> stats {
+    auto it = m_index.find(name);
+    if (it == std::end(m_index)) return {};
+    auto const& t = m_timings[it->second];
+    return summarise(t.history, t.head, t.count);
+}
+
+auto gpu_profiler::imgui() -> void {
+    ImGui::Begin("gpu profiler");
+    if (ImGui::BeginTable("gpu timings", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("pass");
+        ImGui::TableSetupColumn("last ms");
+        ImGui::TableSetupColumn("min ms");
+        ImGui::TableSetupColumn("avg ms");
+        ImGui::TableSetupColumn("p99 ms");
+        ImGui::TableHeadersRow();
+        for (auto const& t : m_timings) {
+            auto const s = summarise(t.history, t.head, t.count);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%*s%s", int(t.depth * 2), "", t.name.c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.last);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.min);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.avg);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", s.p99);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("frames: %zu, dropped: %zu", m_frame, m_dropped);
+    if (ImGui::Button("export json")) save("gpu_profile.json");
+    ImGui::End();
+}
+
+auto gpu_profiler::to_json() const -> std::string {
+    auto quoted = [](std::string const& text) {
+        std::string result{"\""};
+        for (auto const& c : text) {
+            if (c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+        return result + "\"";
+    };
+
+    std::ostringstream out;
+    out << "{\n  \"frames\": " << m_frame << ",\n  \"dropped\": " << m_dropped << ",\n  \"scopes\": [";
+    for (usize i = 0; i < m_timings.size(); i++) {
+        auto const& t = m_timings[i];
+        auto const  s = summarise(t.history, t.head, t.count);
+        out << (i ? ",\n" : "\n")
+            << "    {\"name\": " << quoted(t.name) << ", \"depth\": " << t.depth
+            << ", \"samples\": " << s.samples << ", \"last_ms\": " << s.last
+            << ", \"min_ms\": " << s.min << ", \"avg_ms\": " << s.avg << ", \"p99_ms\": " << s.p99
+            << ", \"history_ms\": [";
+        auto const first = (t.head + t.history.size() - t.count) % t.history.size();
+        for (usize j = 0; j < t.count; j++)
+            out << (j ? ", " : "") << t.history[(first + j) % t.history.size()];
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+auto gpu_profiler::save(std::filesystem::path const& path) const -> bool {
+    std::ofstream file{path};
+    if (!file) {
+        std::cerr << "ERROR::GPU_PROFILER: Failed to open " << path << '\n';
+        return false;
+    }
+    file << to_json();
+    return bool(file);
+}
+
+}
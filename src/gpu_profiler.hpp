@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// GPU pass timings from GL_TIMESTAMP queries. Every frame gets its own slot of
+// queries and results are read `frames` frames later, by then the GPU is done
+// with them and glGetQueryObject never blocks. Scopes may nest.
+class gpu_profiler {
+  public:
+    struct stats {
+        f64   last;     // milliseconds
+        f64   min;
+        f64   avg;
+        f64   p99;
+        usize samples;
+    };
+
+    // RAII helper around begin()/end().
+    class scope {
+      public:
+        scope(gpu_profiler& profiler, char const* name) : m_profiler(profiler) { m_profiler.begin(name); }
+        ~scope() { m_profiler.end(); }
+        scope(scope const&) = delete;
+        auto operator=(scope const&) -> scope& = delete;
+
+      private:
+        gpu_profiler& m_profiler;
+    };
+
+  public:
+    gpu_profiler(usize const& frames = 4, usize const& history = 240);
+    ~gpu_profiler();
+    gpu_profiler(gpu_profiler const&) = delete;
+    auto operator=(gpu_profiler const&) -> gpu_profiler& = delete;
+
+    // Collect the results of the slot about to be reused, then start recording.
+    auto begin_frame() -> void;
+    auto end_frame() -> void;
+
+    auto begin(char const* name) -> void;
+    auto end() -> void;
+
+    auto names() const -> std::vector<std::string>;
+    auto statistics(std::string const& name) const -> stats;
+    // Frames whose results were still pending when their slot came around.
+    auto dropped() const -> usize { return m_dropped; }
+
+    auto imgui() -> void;
+    auto to_json() const -> std::string;
+    auto save(std::filesystem::path const& path) const -> bool;
+
+  private:
+    struct record {
+        u32 timing;
+        u32 depth;
+        u32 first;      // query index of the begin timestamp
+        u32 last;       // query index of the end timestamp
+    };
+
+    struct slot {
+        std::vector<u32>    queries;
+        std::vector<record> records;
+        u32                 used = 0;
+    };
+
+    struct timing {
+        std::string      name;
+        u32              depth = 0;
+        std::vector<f32> history;
+        usize            head  = 0;
+        usize            count = 0;
+    };
+
+    auto query(slot& slot) -> u32;
+    auto collect(slot& slot) -> void;
+    auto find(char const* name) -> u32;
+
+  private:
+    std::vector<slot>                    m_slots;
+    std::vector<timing>                  m_timings;
+    std::unordered_map<std::string, u32> m_index;
+    std::vector<usize>                   m_stack;   // open records
+    usize m_history;
+    usize m_frame   = 0;
+    usize m_dropped = 0;
+    bool  m_is_recording = false;
+};
+
+}
+
+#define LUMA_GPU_SCOPE(profiler, name) \
+    luma::gpu_profiler::scope LUMA_CONCAT(luma_gpu_scope_, __LINE__){profiler, name}
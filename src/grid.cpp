@@ -1,5 +1,7 @@
 #include "grid.hpp"
 
+#include <iterator>
+
 #include "glad/glad.h"
 #include "glm/gtc/type_ptr.hpp"
 
@@ -117,18 +119,15 @@ void main() {
 )";
 
 grid::grid(bool const& is_cw) {
-    m_shader        = shader::create(vertex_shader, fragment_shader);
-    m_array_buffer  = buffer::array::create();
-    m_vertex_buffer = buffer::vertex::create(grid::vertices, sizeof(grid::vertices));
-    m_vertex_buffer->set_layout({{
-        {shader::type::vec2, "a_position"}
-    }});
-    if (is_cw)
-        m_index_buffer = buffer::index::create(grid::cw_indices,  sizeof(grid::cw_indices) / sizeof(uint32_t));
-    else
-        m_index_buffer = buffer::index::create(grid::ccw_indices, sizeof(grid::cw_indices) / sizeof(uint32_t));
-    m_array_buffer->add_vertex_buffer(m_vertex_buffer);
-    m_array_buffer->set_index_buffer(m_index_buffer);
+    m_shader    = shader::create(vertex_shader, fragment_shader);
+    m_primitive = mesh::registry::shared().get({"grid", {is_cw}}, [&] {
+        auto quad = make_ref<mesh::surface>();
+        for (usize i = 0; i < std::size(grid::vertices); i += 2)
+            quad->add_vertex({grid::vertices[i], grid::vertices[i + 1], 0.0f});
+        auto const& indices = is_cw ? grid::cw_indices : grid::ccw_indices;
+        quad->set_indices({std::begin(indices), std::end(indices)});
+        return quad;
+    });
 }
 
 auto grid::render(glm::mat4 const& view, glm::mat4 const& projection, glm::vec2 const& near_far) const -> void {
@@ -139,10 +138,19 @@ auto grid::render(glm::mat4 const& view, glm::mat4 const& projection, glm::vec2
     m_shader->mat4("view", glm::value_ptr(view));
     m_shader->mat4("projection", glm::value_ptr(projection));
 
-    m_array_buffer->bind();
-    m_vertex_buffer->bind();
-    m_index_buffer->bind();
-    glDrawElements(GL_TRIANGLES, m_index_buffer->count(), GL_UNSIGNED_INT, 0);
+    m_primitive->bind();
+    glDrawElements(GL_TRIANGLES, m_primitive->count(), GL_UNSIGNED_INT, 0);
+}
+
+static auto draw_grid(void const* user, render_queue::frame const& frame) -> void {
+    static_cast<grid const*>(user)->render(frame.view, frame.projection, frame.near_far);
 }
+
+auto grid::submit(render_queue& queue, uint8_t const& pass) const -> void {
+    queue.submit(pass, render_queue::blend::transparent, draw_grid, this);
 }
 
+auto grid::submit(command_list& list, uint8_t const& pass) const -> void {
+    list.submit(render_queue::make_command(pass, render_queue::blend::transparent, draw_grid, this));
+}
+}
@@ -3,6 +3,9 @@
 #include "luma.hpp"
 #include "shader.hpp"
 #include "buffer.hpp"
+#include "primitive.hpp"
+#include "render_queue.hpp"
+#include "command_list.hpp"
 #include "glm/glm.hpp"
 
 namespace luma {
@@ -19,12 +22,13 @@ class grid {
 
     auto render(glm::mat4 const& view, glm::mat4 const& projection,
                 glm::vec2 const& near_far = {0.01f, 500.f}) const -> void;
+    // Queue the grid as a transparent packet behind everything else.
+    auto submit(render_queue& queue, uint8_t const& pass = 0) const -> void;
+    auto submit(command_list& list, uint8_t const& pass = 0) const -> void;
 
   private:
-    ref<shader>         m_shader;
-    ref<buffer::array>  m_array_buffer;
-    ref<buffer::vertex> m_vertex_buffer;
-    ref<buffer::index>  m_index_buffer;
+    ref<shader>          m_shader;
+    ref<mesh::primitive> m_primitive;
 
   private:
     static float    vertices[];
@@ -0,0 +1,98 @@
+#include "headless.hpp"
+
+#include <stdexcept>
+
+#include "glad/glad.h"
+
+#ifdef LUMA_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace luma {
+
+#ifdef LUMA_HEADLESS
+static auto surfaceless_display() -> EGLDisplay {
+    auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display) {
+        auto display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY) return display;
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+headless::headless() {
+    auto display = surfaceless_display();
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        throw std::runtime_error("Failed to initialise EGL display");
+    m_display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw std::runtime_error("EGL does not support desktop OpenGL");
+
+    // The default surface type is window, which surfaceless has none of.
+    EGLint const config_attributes[]{
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,   8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE,  8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE,
+    };
+    EGLConfig config{};
+    EGLint    count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &count) || count == 0)
+        throw std::runtime_error("No EGL config for OpenGL");
+
+    // Same version and profile as the window, so shaders stay #version 410.
+    EGLint const context_attributes[]{
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+        EGL_NONE,
+    };
+    m_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+    if (m_context == EGL_NO_CONTEXT)
+        throw std::runtime_error("Failed to create EGL OpenGL 4.1 core context");
+
+    make_current();
+    if (!gladLoadGLLoader(GLADloadproc(eglGetProcAddress)))
+        throw std::runtime_error("Failed to initialize GLAD");
+}
+
+headless::~headless() {
+    if (!m_display) return;
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_context) eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+}
+
+auto headless::make_current() -> void {
+    if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+        throw std::runtime_error("Failed to make the surfaceless EGL context current");
+}
+
+auto headless::release_current() -> void {
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+auto headless::is_supported() -> bool { return true; }
+#else
+headless::headless() {
+    throw std::runtime_error("luma was built without headless support, reconfigure with -Dheadless=enabled");
+}
+headless::~headless() = default;
+auto headless::make_current() -> void {}
+auto headless::release_current() -> void {}
+auto headless::is_supported() -> bool { return false; }
+#endif
+
+auto headless::renderer() const -> std::string {
+    auto name = glGetString(GL_RENDERER);
+    return name ? reinterpret_cast<char const*>(name) : "";
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// GL context without a window or display, for render farms and batch jobs.
+// Uses EGL on the Mesa surfaceless platform, which falls back to the llvmpipe
+// software rasterizer when there is no GPU. Render into a buffer::frame, the
+// context has no default framebuffer.
+class headless {
+  public:
+    headless();
+    ~headless();
+    headless(headless const&) = delete;
+    auto operator=(headless const&) -> headless& = delete;
+
+    auto make_current() -> void;
+    auto release_current() -> void;
+    // GL_RENDERER of the context, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)".
+    auto renderer() const -> std::string;
+
+    static auto is_supported() -> bool;
+
+  private:
+    void* m_display = nullptr;
+    void* m_context = nullptr;
+};
+
+}
@@ -1,25 +1,198 @@
 #include "image.hpp"
+#include "mapped_file.hpp"
+#include "pixel.hpp"
+#include "pixel_pool.hpp"
+#include "profile.hpp"
+#include <algorithm>
 #include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
 
 namespace luma {
 
 image::image(std::string const& filename, int32_t const& channel, bool const& flip)
-    : m_filename(filename), m_width(0), m_height(0), m_channels(channel), m_is_loaded(true) {
-    stbi_set_flip_vertically_on_load(flip);
-    m_buffer = stbi_load(m_filename.c_str(), &m_width, &m_height, &m_channels, 0);
+    : m_filename(filename), m_width(0), m_height(0), m_channels(channel), m_buffer(nullptr),
+      m_capacity(0), m_is_loaded(false), m_is_opaque(true) {
+    LUMA_PROFILE_SCOPE("image::load");
+    // Flipped here, stbi_set_flip_vertically_on_load is a global shared by
+    // every loading thread.
+    int32_t channels = 0;
+    auto const name = m_filename.c_str();
+    if (stbi_is_hdr(name)) {
+        // Halves are plenty for display and take half the memory.
+        auto wide = stbi_loadf(name, &m_width, &m_height, &channels, 4);
+        if (!wide) return;
+        m_type     = pixel::type::f16;
+        m_capacity = usize(m_width) * usize(m_height) * 4 * sizeof(u16);
+        m_buffer   = pixel_pool::shared().acquire(m_capacity);
+        pixel::to_half(wide, reinterpret_cast<u16*>(m_buffer), usize(m_width) * usize(m_height) * 4);
+        stbi_image_free(wide);
+    } else if (stbi_is_16_bit(name)) {
+        m_buffer = reinterpret_cast<u8*>(stbi_load_16(name, &m_width, &m_height, &channels, 4));
+        if (!m_buffer) return;
+        m_type      = pixel::type::u16;
+        m_is_loaded = true;
+    } else {
+        auto decoded = stbi_load(name, &m_width, &m_height, &channels, 0);
+        if (!decoded) return;
+        if (channels == 4) {
+            m_buffer    = decoded;
+            m_is_loaded = true;
+        } else {
+            m_capacity = usize(m_width) * usize(m_height) * 4;
+            m_buffer   = pixel_pool::shared().acquire(m_capacity);
+            pixel::expand_rgba(decoded, channels, m_buffer, usize(m_width) * usize(m_height));
+            stbi_image_free(decoded);
+        }
+    }
+
+    auto const count = usize(m_width) * usize(m_height);
+    m_channels = 4;
+    if (flip) pixel::flip_rows(m_buffer, usize(m_width) * 4 * pixel::sample_size(m_type), m_height);
+    m_is_opaque = !(channels == 2 || channels == 4);
+    if (!m_is_opaque) {
+        auto const samples = reinterpret_cast<u16 const*>(m_buffer);
+        m_is_opaque = m_type == pixel::type::u8  ? pixel::is_opaque(m_buffer, count)
+                    : m_type == pixel::type::u16 ? pixel::is_opaque(samples, count, 0xffff)
+                    : pixel::is_opaque(samples, count, 0x3c00);
+    }
+}
+
+image::image(int32_t const& width, int32_t const& height, int32_t const& channels, pixel::type const& type)
+    : m_width(width), m_height(height), m_channels(channels), m_type(type),
+      m_capacity(usize(width) * usize(height) * usize(channels) * pixel::sample_size(type)), m_is_loaded(false),
+      m_is_opaque(channels != 2 && channels != 4) {
+    m_buffer = pixel_pool::shared().acquire(m_capacity);
+}
+
+image::image(ref<mapped_file> const& mapping, usize const& offset, int32_t const& width, int32_t const& height,
+             int32_t const& channels, bool const& is_opaque, pixel::type const& type)
+    : m_width(width), m_height(height), m_channels(channels), m_type(type), m_capacity(0), m_is_loaded(false),
+      m_is_opaque(is_opaque), m_mapping(mapping) {
+    m_buffer = mapping->data() + offset;
+}
+
+image::image(image&& other) noexcept
+    : m_filename(std::move(other.m_filename)), m_width(other.m_width), m_height(other.m_height),
+      m_channels(other.m_channels), m_type(other.m_type), m_buffer(std::exchange(other.m_buffer, nullptr)),
+      m_capacity(std::exchange(other.m_capacity, 0)), m_is_loaded(std::exchange(other.m_is_loaded, false)),
+      m_is_opaque(other.m_is_opaque), m_mapping(std::move(other.m_mapping)), m_mips(std::move(other.m_mips)) {
 }
 
-image::image(int32_t const& width, int32_t const& height, int32_t const& channels)
-    : m_width(width), m_height(height), m_channels(channels), m_is_loaded(false) {
-    m_buffer = new uint8_t[m_width * m_height * m_channels];
+auto image::operator=(image&& other) noexcept -> image& {
+    if (this == &other) return *this;
+    release();
+    m_filename  = std::move(other.m_filename);
+    m_width     = other.m_width;
+    m_height    = other.m_height;
+    m_channels  = other.m_channels;
+    m_type      = other.m_type;
+    m_buffer    = std::exchange(other.m_buffer, nullptr);
+    m_capacity  = std::exchange(other.m_capacity, 0);
+    m_is_loaded = std::exchange(other.m_is_loaded, false);
+    m_is_opaque = other.m_is_opaque;
+    m_mapping   = std::move(other.m_mapping);
+    m_mips      = std::move(other.m_mips);
+    return *this;
 }
 
 image::~image() {
-    if (m_is_loaded) stbi_image_free(m_buffer);
-    else delete[] m_buffer;
+    release();
+}
+
+auto image::release() -> void {
+    if (m_mapping) m_mapping.reset();
+    else if (m_is_loaded) stbi_image_free(m_buffer);
+    else pixel_pool::shared().release(m_buffer, m_capacity);
+    m_buffer    = nullptr;
+    m_capacity  = 0;
+    m_is_loaded = false;
+}
+
+auto image::resize(int32_t const& width, int32_t const& height) -> void {
+    auto const bytes = usize(width) * usize(height) * usize(m_channels) * pixel::sample_size(m_type);
+    m_mips.clear();
+    m_width  = width;
+    m_height = height;
+    if (m_buffer && m_capacity && pixel_pool::capacity(bytes) == pixel_pool::capacity(m_capacity)) {
+        // Same class, the pool would hand back this very buffer size anyway.
+        m_capacity = bytes;
+        return;
+    }
+    release();
+    m_capacity = bytes;
+    m_buffer   = pixel_pool::shared().acquire(m_capacity);
+}
+
+auto image::write(std::string const& filename) const -> bool {
+    LUMA_PROFILE_SCOPE("image::write");
+    // Pixels are kept bottom row first, walk them backwards with a negative
+    // stride instead of the global stbi_flip_vertically_on_write.
+    auto const stride = m_width * m_channels * int32_t(pixel::sample_size(m_type));
+    auto const last   = m_buffer + usize(stride) * usize(std::max(m_height - 1, 0));
+    if (filename.ends_with(".png") && m_type != pixel::type::u8) {
+        std::cerr << "ERROR::IMAGE: PNG takes 8-bit samples, write " << filename << " raw instead\n";
+        return false;
+    }
+    if (filename.ends_with(".png"))
+        return stbi_write_png(filename.c_str(), m_width, m_height, m_channels, last, -stride) != 0;
+
+    std::ofstream file{filename, std::ios::binary};
+    for (int32_t y = 0; y < m_height && file; y++)
+        file.write(reinterpret_cast<char const*>(last - isize(stride) * y), stride);
+    return bool(file);
+}
+
+auto image::build_mips(resample::filter const& kind) -> void {
+    m_mips = make_mips(kind);
+}
+
+auto image::make_mips(resample::filter const& kind) const -> std::vector<ref<image>> {
+    LUMA_PROFILE_SCOPE("image::build_mips");
+    std::vector<ref<image>> mips;
+    if (!m_buffer) return mips;
+
+    // The previous level is kept in linear float so rounding doesn't
+    // accumulate down the chain.
+    resample::surface level;
+    auto width  = m_width;
+    auto height = m_height;
+    while (width > 1 || height > 1) {
+        auto const next_width  = std::max(width / 2, 1);
+        auto const next_height = std::max(height / 2, 1);
+        level = mips.empty()
+            ? resample::resize(m_buffer, m_type, width, height, m_channels, next_width, next_height, kind)
+            : resample::resize(level, next_width, next_height, kind);
+        auto mip = make_ref<image>(next_width, next_height, m_channels, m_type);
+        mip->m_is_opaque = m_is_opaque;
+        resample::encode(level, m_channels, m_type, mip->buffer());
+        mips.push_back(mip);
+        width  = next_width;
+        height = next_height;
+    }
+    return mips;
+}
+
+auto image::resized(int32_t const& width, int32_t const& height, resample::filter const& kind) const -> ref<image> {
+    LUMA_PROFILE_SCOPE("image::resized");
+    auto result = make_ref<image>(width, height, m_channels, m_type);
+    result->m_is_opaque = m_is_opaque;
+    if (m_buffer) {
+        auto const level = resample::resize(m_buffer, m_type, m_width, m_height, m_channels, width, height, kind);
+        resample::encode(level, m_channels, m_type, result->m_buffer);
+    }
+    return result;
+}
+
+auto image::thumbnail(int32_t const& max_side, resample::filter const& kind) const -> ref<image> {
+    auto const size = resample::fit(m_width, m_height, max_side);
+    return resized(size.width, size.height, kind);
 }
 
 }
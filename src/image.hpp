@@ -2,19 +2,66 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
+
+#include "luma.hpp"
+#include "pixel.hpp"
+#include "resample.hpp"
 
 namespace luma {
+class mapped_file;
+
 class image {
   public:
+    // Decoded to RGBA, rows bottom first unless `flip` is false. 16-bit
+    // files keep u16 samples and HDR ones linear f16, the rest is 8-bit.
+    // Safe to call from several threads.
     image(std::string const& filename, int32_t const& channel = 0, bool const& flip = true);
-    image(int32_t const& width, int32_t const& height, int32_t const& channels = 3);
-    //image(image const& img);
+    image(int32_t const& width, int32_t const& height, int32_t const& channels = 3,
+          pixel::type const& type = pixel::type::u8);
+    // Pixels live in the mapping at `offset`, kept open as long as the image.
+    image(ref<mapped_file> const& mapping, usize const& offset, int32_t const& width, int32_t const& height,
+          int32_t const& channels, bool const& is_opaque, pixel::type const& type = pixel::type::u8);
+    image(image&& other) noexcept;
+    auto operator=(image&& other) noexcept -> image&;
+    image(image const&) = delete;
+    auto operator=(image const&) -> image& = delete;
     ~image();
 
     auto buffer() const -> uint8_t* { return m_buffer; }
     auto width() const -> int32_t { return m_width; }
     auto height() const -> int32_t { return m_height; }
     auto channels() const -> int32_t { return m_channels; }
+    auto type() const -> pixel::type { return m_type; }
+    // Of this level, without the mips.
+    auto bytes() const -> usize {
+        return usize(m_width) * usize(m_height) * usize(m_channels) * pixel::sample_size(m_type);
+    }
+    auto is_mapped() const -> bool { return m_mapping != nullptr; }
+    // Every alpha is 255, or there is no alpha channel.
+    auto is_opaque() const -> bool { return m_is_opaque; }
+
+    // New size, contents undefined and mips dropped. Keeps the buffer when
+    // its size class still fits, otherwise swaps it through the pixel_pool.
+    auto resize(int32_t const& width, int32_t const& height) -> void;
+
+    // PNG when the name ends in .png, which takes 8-bit samples only,
+    // otherwise the raw pixels. Either way rows are written top first.
+    auto write(std::string const& filename) const -> bool;
+
+    // Halves down to 1x1, each level filtered in linear light from the one
+    // above. CPU only, so it can run wherever the image was loaded.
+    auto build_mips(resample::filter const& kind = resample::filter::kaiser) -> void;
+    // The same chain without touching the image, for building it on another
+    // thread while this one is in use.
+    auto make_mips(resample::filter const& kind = resample::filter::kaiser) const -> std::vector<ref<image>>;
+    // A filtered copy at any size, without mips.
+    auto resized(int32_t const& width, int32_t const& height,
+                 resample::filter const& kind = resample::filter::lanczos) const -> ref<image>;
+    // Longer side at most `max_side`, the aspect kept.
+    auto thumbnail(int32_t const& max_side, resample::filter const& kind = resample::filter::mitchell) const -> ref<image>;
+    auto mips() const -> std::vector<ref<image>> const& { return m_mips; }
+    auto set_mips(std::vector<ref<image>>&& mips) -> void { m_mips = std::move(mips); }
 
     auto info() const -> std::string {
         return std::string("luma::image{width: ") + std::to_string(m_width) 
@@ -22,13 +69,21 @@ class image {
                + ", channels: " + std::to_string(m_channels) + "}";
     }
 
+  private:
+    auto release() -> void;
+
   private:
     std::string m_filename;
     int32_t     m_width;
     int32_t     m_height;
     int32_t     m_channels;
+    pixel::type m_type = pixel::type::u8;
     uint8_t*    m_buffer;
+    usize       m_capacity;     // pooled bytes, 0 when stbi or the mapping owns the buffer
     bool        m_is_loaded;
+    bool        m_is_opaque;
+    ref<mapped_file>        m_mapping;
+    std::vector<ref<image>> m_mips;
 };
 }
 
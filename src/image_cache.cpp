@@ -0,0 +1,346 @@
+#include "image_cache.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace luma {
+
+namespace {
+constexpr char  MAGIC[8]{'L', 'U', 'M', 'A', 'I', 'M', 'G', '1'};
+constexpr u32   VERSION    = 3;
+constexpr usize PAGE       = 4096;
+constexpr usize MAX_LEVELS = 32;
+constexpr u32   FLAG_OPAQUE = 1;
+
+struct level_entry {
+    u64 offset;
+    i32 width;
+    i32 height;
+};
+
+struct header {
+    char        magic[8];
+    u32         version;
+    u32         levels;
+    u64         source_size;
+    i64         source_mtime;
+    u64         source_hash;
+    i32         channels;
+    u32         flags;
+    u32         type;       // pixel::type
+    level_entry table[MAX_LEVELS];
+};
+static_assert(sizeof(header) <= PAGE);
+
+auto page_align(usize const& size) -> usize {
+    return (size + PAGE - 1) / PAGE * PAGE;
+}
+
+// Eight bytes a step, fast enough that checking a touched file costs about
+// as much as reading it.
+auto hash(u8 const* data, usize const& size) -> u64 {
+    constexpr u64 k = 0x9E3779B97F4A7C15ull;
+    u64 h = size * k;
+    usize i = 0;
+    for (; i + 8 <= size; i += 8) {
+        u64 word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * k;
+        h ^= h >> 29;
+    }
+    u64 tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = (h ^ tail) * k;
+    return h ^ (h >> 32);
+}
+
+auto hash_file(std::filesystem::path const& path) -> u64 {
+    LUMA_PROFILE_SCOPE("image_cache::hash");
+    mapped_file file{path.string()};
+    return file.is_open() ? hash(file.data(), file.size()) : 0;
+}
+
+auto bytes(level_entry const& level, header const& h) -> usize {
+    return usize(level.width) * usize(level.height) * usize(h.channels) * pixel::sample_size(pixel::type(h.type));
+}
+}
+
+image_cache::image_cache(std::filesystem::path const& directory, usize const& limit)
+    : m_directory(directory), m_limit(limit) {
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error) {
+        std::cerr << "ERROR::IMAGE_CACHE: Cannot create " << m_directory << ", " << error.message() << '\n';
+        m_is_enabled = false;
+    }
+}
+
+image_cache::~image_cache() {
+    std::unique_lock lock{m_mutex};
+    m_condition.wait(lock, [this] { return m_pending == 0; });
+}
+
+auto image_cache::inspect(std::filesystem::path const& path) -> std::optional<source> {
+    std::error_code error;
+    auto const size  = std::filesystem::file_size(path, error);
+    if (error) return std::nullopt;
+    auto const mtime = std::filesystem::last_write_time(path, error);
+    if (error) return std::nullopt;
+    return source{u64(size), i64(mtime.time_since_epoch().count())};
+}
+
+auto image_cache::get(std::string const& filename, bool const& mipmap) -> ref<image> {
+    std::error_code error;
+    auto const canonical = std::filesystem::weakly_canonical(filename, error);
+    auto const info = error ? std::nullopt : inspect(canonical);
+    if (m_is_enabled && info) {
+        if (auto cached = lookup(canonical, *info, mipmap)) return cached;
+    }
+
+    auto decoded = make_ref<image>(filename);
+    if (!decoded->buffer()) return decoded;
+    if (mipmap) decoded->build_mips();
+    if (m_is_enabled && info) submit(canonical, decoded, *info);
+    return decoded;
+}
+
+auto image_cache::load(std::string const& filename, bool const& mipmap) -> ref<image> {
+    std::error_code error;
+    auto const canonical = std::filesystem::weakly_canonical(filename, error);
+    if (error) return nullptr;
+    auto const info = inspect(canonical);
+    return info ? lookup(canonical, *info, mipmap) : nullptr;
+}
+
+auto image_cache::store(std::string const& filename, image const& source) -> bool {
+    std::error_code error;
+    auto const canonical = std::filesystem::weakly_canonical(filename, error);
+    if (error) return false;
+    auto const info = inspect(canonical);
+    return info && write(canonical, source, *info);
+}
+
+auto image_cache::store_async(std::string const& filename, ref<image> const& source, image_cache::source const& info)
+    -> void {
+    std::error_code error;
+    auto const canonical = std::filesystem::weakly_canonical(filename, error);
+    if (m_is_enabled && !error) submit(canonical, source, info);
+}
+
+auto image_cache::submit(std::filesystem::path const& canonical, ref<image> const& source,
+                         image_cache::source const& info) -> void {
+    {
+        std::lock_guard lock{m_mutex};
+        m_pending++;
+    }
+    thread_pool::shared().submit([this, source, canonical, info] {
+        write(canonical, *source, info);
+        std::lock_guard lock{m_mutex};
+        m_pending--;
+        m_condition.notify_all();
+    });
+}
+
+auto image_cache::statistics() const -> stats {
+    return {m_hits.load(), m_misses.load(), m_invalidated.load(), m_writes.load()};
+}
+
+auto image_cache::entry(std::filesystem::path const& canonical) const -> std::filesystem::path {
+    auto const name = canonical.string();
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx",
+                  static_cast<unsigned long long>(hash(reinterpret_cast<u8 const*>(name.data()), name.size())));
+    return m_directory / (std::string{hex} + ".lumi");
+}
+
+auto image_cache::lookup(std::filesystem::path const& canonical, source const& info, bool const& mipmap) -> ref<image> {
+    LUMA_PROFILE_SCOPE("image_cache::load");
+    auto const path = entry(canonical);
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        m_misses++;
+        return nullptr;
+    }
+
+    auto mapping = make_ref<mapped_file>(path.string());
+    header h{};
+    auto is_valid = mapping->is_open() && mapping->size() >= sizeof(header);
+    if (is_valid) {
+        std::memcpy(&h, mapping->data(), sizeof(header));
+        is_valid = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION
+                && h.levels >= 1 && h.levels <= MAX_LEVELS && h.channels >= 1 && h.channels <= 4
+                && h.type <= u32(pixel::type::f32);
+        for (u32 i = 0; is_valid && i < h.levels; i++)
+            is_valid = h.table[i].offset % PAGE == 0 && h.table[i].width > 0 && h.table[i].height > 0
+                    && h.table[i].offset + bytes(h.table[i], h) <= mapping->size();
+    }
+
+    // Unchanged size but a new mtime is often just a touch or a copy, the
+    // hash decides.
+    auto is_current = is_valid && h.source_size == info.size;
+    if (is_current && h.source_mtime != info.mtime) {
+        is_current = hash_file(canonical) == h.source_hash;
+        if (is_current) {
+            std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+            file.seekp(offsetof(header, source_mtime));
+            file.write(reinterpret_cast<char const*>(&info.mtime), sizeof(info.mtime));
+        }
+    }
+    if (!is_current) {
+        m_invalidated++;
+        m_misses++;
+        if (std::filesystem::remove(path, error)) trim(0, mapping->size());
+        return nullptr;
+    }
+    auto const& top = h.table[0];
+    if (mipmap && h.levels == 1 && (top.width > 1 || top.height > 1)) {
+        m_misses++;
+        return nullptr;
+    }
+
+    auto const levels = mipmap ? h.levels : 1;
+    auto const& last  = h.table[levels - 1];
+    mapping->prefetch(top.offset, last.offset + bytes(last, h) - top.offset);
+
+    auto const is_opaque = (h.flags & FLAG_OPAQUE) != 0;
+    auto const type      = pixel::type(h.type);
+    auto result = make_ref<image>(mapping, top.offset, top.width, top.height, h.channels, is_opaque, type);
+    std::vector<ref<image>> mips;
+    for (u32 i = 1; i < levels; i++)
+        mips.push_back(make_ref<image>(mapping, h.table[i].offset, h.table[i].width, h.table[i].height,
+                                       h.channels, is_opaque, type));
+    result->set_mips(std::move(mips));
+
+    // Recently used entries survive trim().
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    m_hits++;
+    return result;
+}
+
+auto image_cache::write(std::filesystem::path const& canonical, image const& source, image_cache::source const& info) -> bool {
+    LUMA_PROFILE_SCOPE("image_cache::write");
+    if (!source.buffer() || source.mips().size() + 1 > MAX_LEVELS) return false;
+
+    header h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version      = VERSION;
+    h.levels       = u32(source.mips().size() + 1);
+    h.source_size  = info.size;
+    h.source_mtime = info.mtime;
+    h.source_hash  = hash_file(canonical);
+    h.channels     = source.channels();
+    h.flags        = source.is_opaque() ? FLAG_OPAQUE : 0;
+    h.type         = u32(source.type());
+
+    // The source changed while it was decoded or hashed, the pixels may be
+    // from either version.
+    auto const now = inspect(canonical);
+    if (!now || now->size != info.size || now->mtime != info.mtime) return false;
+
+    std::vector<image const*> levels{&source};
+    for (auto const& mip : source.mips()) levels.push_back(mip.get());
+    usize offset = PAGE;
+    for (usize i = 0; i < levels.size(); i++) {
+        h.table[i] = {offset, levels[i]->width(), levels[i]->height()};
+        offset += page_align(bytes(h.table[i], h));
+    }
+
+    // Written aside and renamed, readers never see a partial entry.
+    auto const path = entry(canonical);
+    auto temporary  = path;
+    temporary += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        std::vector<char> const padding(PAGE, 0);
+        file.write(reinterpret_cast<char const*>(&h), sizeof(h));
+        file.write(padding.data(), isize(PAGE - sizeof(h)));
+        for (usize i = 0; i < levels.size() && file; i++) {
+            auto const size = bytes(h.table[i], h);
+            file.write(reinterpret_cast<char const*>(levels[i]->buffer()), isize(size));
+            file.write(padding.data(), isize(page_align(size) - size));
+        }
+        if (!file) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            std::cerr << "ERROR::IMAGE_CACHE: Failed to write " << path << '\n';
+            return false;
+        }
+    }
+    std::error_code error;
+    auto const replaced = std::filesystem::file_size(path, error);
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    m_writes++;
+    trim(offset, replaced == std::uintmax_t(-1) ? 0 : usize(replaced));
+    return true;
+}
+
+auto image_cache::trim(usize const& added, usize const& removed) -> void {
+    struct file {
+        std::filesystem::path           path;
+        std::filesystem::file_time_type time;
+        usize                           size;
+    };
+    std::lock_guard lock{m_trim_mutex};
+    if (m_is_counted) {
+        m_bytes = m_bytes + added - std::min(removed, m_bytes + added);
+        if (m_bytes <= m_limit) return;
+    }
+
+    // Other processes share the directory, the scan also resyncs the total.
+    std::vector<file> files;
+    usize total = 0;
+    std::error_code error;
+    for (auto const& it : std::filesystem::directory_iterator{m_directory, error}) {
+        if (it.path().extension() != ".lumi") continue;
+        auto const size = usize(it.file_size(error));
+        if (error) continue;
+        files.push_back({it.path(), it.last_write_time(error), size});
+        total += size;
+    }
+    m_bytes      = total;
+    m_is_counted = true;
+    if (total <= m_limit) return;
+
+    std::sort(std::begin(files), std::end(files), [](file const& a, file const& b) { return a.time < b.time; });
+    for (auto const& f : files) {
+        if (total <= m_limit) break;
+        // Open mappings keep working, the pages live until they're unmapped.
+        if (std::filesystem::remove(f.path, error)) total -= f.size;
+    }
+    m_bytes = total;
+}
+
+static auto default_directory() -> std::filesystem::path {
+    if (auto const path = std::getenv("LUMA_IMAGE_CACHE"); path && *path) return path;
+#ifdef __APPLE__
+    if (auto const home = std::getenv("HOME"); home && *home) return std::filesystem::path{home} / "Library/Caches/luma/images";
+#else
+    if (auto const xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) return std::filesystem::path{xdg} / "luma/images";
+    if (auto const home = std::getenv("HOME"); home && *home) return std::filesystem::path{home} / ".cache/luma/images";
+#endif
+    std::error_code error;
+    return std::filesystem::temp_directory_path(error) / "luma-images";
+}
+
+auto image_cache::shared() -> image_cache& {
+    static image_cache instance{default_directory()};
+    return instance;
+}
+
+}
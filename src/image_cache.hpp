@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "luma.hpp"
+#include "image.hpp"
+
+namespace luma {
+
+// Decoded images on disk, so a warm reload is a page-aligned mmap instead of
+// a JPEG/PNG decode. An entry holds the pixels exactly as luma::image keeps
+// them, bottom row first, with the mip chain, each level on its own page so
+// GL can upload straight from the mapping.
+//
+// Entries are named after the canonical source path and remember the source
+// size, mtime and content hash. A changed size or hash invalidates the entry,
+// a changed mtime alone only costs a rehash. The directory is trimmed oldest
+// first past `limit` bytes.
+class image_cache {
+  public:
+    struct stats {
+        u64 hits;
+        u64 misses;
+        u64 invalidated;
+        u64 writes;
+    };
+
+    // What an entry remembers of its source file besides the content hash.
+    struct source {
+        u64 size  = 0;
+        i64 mtime = 0;
+
+        auto operator==(source const& other) const -> bool = default;
+    };
+
+  public:
+    image_cache(std::filesystem::path const& directory, usize const& limit = usize(4) << 30);
+    ~image_cache();
+
+    // Mapped from the cache when possible, otherwise decoded, mipmapped if
+    // asked and written back on the shared thread_pool.
+    auto get(std::string const& filename, bool const& mipmap = true) -> ref<image>;
+    // Null when there is no valid entry, or one without mips when they're asked for.
+    auto load(std::string const& filename, bool const& mipmap = true) -> ref<image>;
+    auto store(std::string const& filename, image const& source) -> bool;
+    // Written on the shared thread_pool like get() does, `info` being the
+    // file as it was when `source` was decoded.
+    auto store_async(std::string const& filename, ref<image> const& source, image_cache::source const& info) -> void;
+
+    auto set_enabled(bool const& is_enabled) -> void { m_is_enabled = is_enabled; }
+    auto is_enabled() const -> bool { return m_is_enabled; }
+    auto directory() const -> std::filesystem::path const& { return m_directory; }
+    auto statistics() const -> stats;
+
+    // $LUMA_IMAGE_CACHE, else the platform's user cache directory.
+    static auto shared() -> image_cache&;
+    // Null when the file can't be read.
+    static auto inspect(std::filesystem::path const& path) -> std::optional<source>;
+
+  private:
+    auto entry(std::filesystem::path const& canonical) const -> std::filesystem::path;
+    auto lookup(std::filesystem::path const& canonical, source const& info, bool const& mipmap) -> ref<image>;
+    auto write(std::filesystem::path const& canonical, image const& source, image_cache::source const& info) -> bool;
+    auto submit(std::filesystem::path const& canonical, ref<image> const& source, image_cache::source const& info) -> void;
+    // Adjusts the running total, the directory is only scanned to count it
+    // the first time and to trim once the total is past the limit.
+    auto trim(usize const& added, usize const& removed = 0) -> void;
+
+  private:
+    std::filesystem::path m_directory;
+    usize                 m_limit;
+    std::atomic<bool>     m_is_enabled{true};
+
+    std::atomic<u64> m_hits{0};
+    std::atomic<u64> m_misses{0};
+    std::atomic<u64> m_invalidated{0};
+    std::atomic<u64> m_writes{0};
+
+    // Background writes, waited for on destruction.
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    usize                   m_pending = 0;
+    std::mutex              m_trim_mutex;
+    usize                   m_bytes      = 0;   // entries on disk, once counted
+    bool                    m_is_counted = false;
+};
+
+}
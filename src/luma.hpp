@@ -6,6 +6,8 @@
 #include <cstdint>
 
 #define LUMA_BIT(x) 1 << x
+#define LUMA_CONCAT_(a, b) a##b
+#define LUMA_CONCAT(a, b) LUMA_CONCAT_(a, b)
 
 namespace luma {
 template <typename T>
@@ -37,13 +39,17 @@ namespace buffer {
 struct element;
 class layout;
 class vertex;
+class stream;
 class array;
+class arena;
 class frame;
 }
 
 namespace mesh {
 struct vertex;
 class surface;
+class primitive;
+class registry;
 }
 
 // luma types
@@ -1,9 +1,18 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <filesystem>
 #include <array>
+#include <charconv>
 #include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
 
 #include "luma.hpp"
 #include "window.hpp"
@@ -11,11 +20,27 @@
 #include "shader.hpp"
 #include "image.hpp"
 #include "texture.hpp"
+#include "texture_cache.hpp"
+#include "image_cache.hpp"
+#include "bc.hpp"
+#include "resample.hpp"
 #include "camera.hpp"
 #include "input.hpp"
 #include "mesh.hpp"
+#include "primitive.hpp"
 #include "grid.hpp"
+#include "render_queue.hpp"
+#include "command_list.hpp"
+#include "thread_pool.hpp"
+#include "render_thread.hpp"
+#include "gpu_profiler.hpp"
+#include "profile.hpp"
+#include "frame_pacer.hpp"
+#include "headless.hpp"
+#include "capture.hpp"
 #include "event.hpp"
+#include "sequence.hpp"
+#include "filmstrip.hpp"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -51,9 +76,18 @@ in vec4 io_color;
 in vec2 io_uv;
 
 uniform sampler2D u_texture;
+// Float textures hold linear light, encoded here like the rest of the scene.
+// Past 1 is kept when the target is float.
+uniform int u_is_linear;
+
+vec3 encode(vec3 linear) {
+    linear = max(linear, 0.0);
+    return mix(linear * 12.92, 1.055 * pow(linear, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, linear));
+}
 
 void main() {
     color = texture(u_texture, io_uv);
+    if (u_is_linear != 0) color.rgb = encode(color.rgb);
 }
 )";
 
@@ -79,16 +113,409 @@ in vec4 io_color;
 in vec2 io_uv;
 
 uniform sampler2D u_texture;
+// 2^stops, scaled in linear light.
+uniform float u_exposure;
+
+vec3 decode(vec3 srgb) {
+    srgb = max(srgb, 0.0);
+    return mix(srgb / 12.92, pow((srgb + 0.055) / 1.055, vec3(2.4)), step(0.04045, srgb));
+}
+
+vec3 encode(vec3 linear) {
+    return mix(linear * 12.92, 1.055 * pow(linear, vec3(1.0 / 2.4)) - 0.055, step(0.0031308, linear));
+}
 
 void main() {
     color = texture(u_texture, io_uv);
+    if (u_exposure != 1.0) color.rgb = encode(decode(color.rgb) * u_exposure);
 }
 )";
 
-auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> int32_t {
+// Float textures set u_is_linear on the plane, every packet sets it since
+// the shader is shared.
+static int32_t const linear_flags[2]{0, 1};
+static luma::render_queue::uniform const linear_uniforms[2]{
+    {"u_is_linear", luma::shader::type::i32, 1, &linear_flags[0], nullptr},
+    {"u_is_linear", luma::shader::type::i32, 1, &linear_flags[1], nullptr},
+};
+
+static auto plane_command(luma::render_queue const& queue, luma::shader& shader, luma::texture const& texture,
+                          luma::mesh::primitive const& plane, glm::mat4 const& model) -> luma::render_queue::command {
+    auto const blend = texture.is_opaque() ? luma::render_queue::blend::opaque
+                                           : luma::render_queue::blend::transparent;
+    auto command = luma::render_queue::make_command(0, blend, shader, texture.id(), plane, model,
+                                                    queue.depth(glm::vec3(model[3])));
+    command.uniforms = &linear_uniforms[luma::pixel::is_float(texture.type()) ? 1 : 0];
+    return command;
+}
+
+// Everything the render pass needs from the simulation, copied once per frame
+// so the render thread never reads state the main thread is updating.
+struct frame_snapshot {
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::vec2 near_far{0.1f, 1000.0f};
+    glm::mat4 model{1.0f};
+    int32_t   width  = 0;
+    int32_t   height = 0;
+    bool      is_recording = false;
+    luma::usize image      = 0;
+    float     exposure     = 0.0f;  // stops
+    bool      is_filmstrip = true;
+};
+
+// luma --headless [options] image...
+//   --size <w>x<h>     output size, default 512x512
+//   --out <dir>        output directory, default .
+//   --format png|raw   output format, default png
+//   --grid             draw the grid over the plane
+//   --camera <x,y,z>   camera position, default 0,0,2
+//   --frames <n>       renders per image, for throughput measurements
+//   --compress         upload textures as BC1/BC3
+//   --residency discard|proxy|keep
+//                      CPU pixels held after upload, default discard
+//   --max-size <n>     longer side of uploaded textures, default GL's limit
+struct headless_options {
+    int32_t   width  = 512;
+    int32_t   height = 512;
+    std::filesystem::path out{"."};
+    std::string format{"png"};
+    bool      is_grid = false;
+    glm::vec3 camera{0.0f, 0.0f, 2.0f};
+    int32_t   frames = 1;
+    bool      is_compressed = false;
+    luma::residency residency = luma::residency::discard;
+    int32_t   max_size = 0;
+    std::vector<std::string> images;
+};
+
+// True if all of text parses as a number, trailing characters included.
+template <typename T>
+static auto parse_number(char const* text, T& value) -> bool {
+    auto const end = text + std::strlen(text);
+    auto const [last, error] = std::from_chars(text, end, value);
+    return error == std::errc{} && last == end;
+}
+
+static auto parse_headless(int32_t argc, char const* argv[]) -> headless_options {
+    headless_options options{};
+    auto value = [&](int32_t& i) -> char const* {
+        if (i + 1 >= argc) throw std::runtime_error(std::string{"missing value for "} + argv[i]);
+        return argv[++i];
+    };
+    for (int32_t i = 0; i < argc; i++) {
+        auto const arg = std::string_view{argv[i]};
+        if (arg == "--size") {
+            if (std::sscanf(value(i), "%dx%d", &options.width, &options.height) != 2
+                || options.width <= 0 || options.height <= 0)
+                throw std::runtime_error("--size expects <width>x<height>");
+        } else if (arg == "--out") {
+            options.out = value(i);
+        } else if (arg == "--format") {
+            options.format = value(i);
+            if (options.format != "png" && options.format != "raw")
+                throw std::runtime_error("--format expects png or raw");
+        } else if (arg == "--grid") {
+            options.is_grid = true;
+        } else if (arg == "--camera") {
+            auto& c = options.camera;
+            if (std::sscanf(value(i), "%f,%f,%f", &c.x, &c.y, &c.z) != 3)
+                throw std::runtime_error("--camera expects <x>,<y>,<z>");
+        } else if (arg == "--frames") {
+            if (!parse_number(value(i), options.frames) || options.frames < 1)
+                throw std::runtime_error("--frames expects a positive integer");
+        } else if (arg == "--compress") {
+            options.is_compressed = true;
+        } else if (arg == "--residency") {
+            auto const policy = std::string_view{value(i)};
+            if (policy == "discard") options.residency = luma::residency::discard;
+            else if (policy == "proxy") options.residency = luma::residency::proxy;
+            else if (policy == "keep") options.residency = luma::residency::keep;
+            else throw std::runtime_error("--residency expects discard, proxy or keep");
+        } else if (arg == "--max-size") {
+            if (!parse_number(value(i), options.max_size) || options.max_size < 0)
+                throw std::runtime_error("--max-size expects a non-negative integer");
+        } else if (arg.starts_with("--")) {
+            throw std::runtime_error(std::string{"unknown option "} + argv[i]);
+        } else {
+            options.images.emplace_back(arg);
+        }
+    }
+    if (options.images.empty()) throw std::runtime_error("no input images");
+    return options;
+}
+
+// Empties the shared texture cache on scope exit. Declared right after the
+// context, so the cached textures are deleted while it still exists.
+struct texture_cache_guard {
+    ~texture_cache_guard() { luma::texture_cache::shared().clear(); }
+};
+
+// Renders every image on the plane into an offscreen frame and writes it out.
+// Reports throughput per core, as llvmpipe spreads rasterisation over all of
+// them.
+static auto render_headless(headless_options const& options) -> int32_t {
+    luma::headless context{};
+    texture_cache_guard textures{};
+    std::cout << "luma::headless{renderer: " << context.renderer() << "}\n";
+
+    luma::shader shader{vertex_shader, fragment_shader};
+    luma::grid grid_render{};
+    luma::render_queue queue{};
+    luma::buffer::frame target{options.width, options.height};
+    luma::image pixels{options.width, options.height, 4};
+    luma::texture::set_max_size(options.max_size);
+    auto plane = luma::mesh::registry::shared().plane();
+
+    luma::camera camera{};
+    camera.position = options.camera;
+    camera.update_perspective(float(options.width) / float(options.height), 45.0f);
+    auto const model = glm::translate(glm::mat4{1.0f}, {0.0f, 1.f, 0.0f});
+    std::filesystem::create_directories(options.out);
+
+    luma::usize frames = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (auto const& filename : options.images) {
+        LUMA_PROFILE_SCOPE("headless::image");
+        auto texture = luma::texture_cache::shared().get(filename, true, options.is_compressed, options.residency);
+        if (!texture->is_loaded()) {
+            std::cerr << "ERROR::HEADLESS: Failed to load " << filename << '\n';
+            continue;
+        }
+        // Frames must not depend on how soon the mips are ready.
+        texture->finish();
+        for (int32_t i = 0; i < options.frames; i++) {
+            target.bind();
+            glViewport(0, 0, options.width, options.height);
+            glClearColor(0.f, 0.f, 0.f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            queue.begin(camera.world_to_view(), camera.projection(), glm::vec2{camera.near, camera.far});
+            queue.submit(plane_command(queue, shader, *texture, *plane, model));
+            if (options.is_grid) grid_render.submit(queue, 1);
+            queue.sort();
+            queue.execute();
+            target.unbind();
+            frames++;
+        }
+
+        target.read(pixels.buffer());
+        auto output = options.out / std::filesystem::path{filename}.stem();
+        output += "." + options.format;
+        if (!pixels.write(output.string()))
+            std::cerr << "ERROR::HEADLESS: Failed to write " << output << '\n';
+    }
+    glFinish();
+
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto const cores   = std::max(std::thread::hardware_concurrency(), 1u);
+    auto const fps     = double(frames) / std::max(seconds, 1e-9);
+    std::cout << "rendered " << frames << " frames in " << seconds << "s, "
+              << fps << " fps, " << fps / cores << " fps/core (" << cores << " cores)\n";
+    auto const cache = luma::texture_cache::shared().statistics();
+    std::cout << "texture cache: " << cache.hits << " hits, " << cache.misses << " misses, "
+              << cache.evictions << " evictions\n";
+    std::cout << "texture memory: " << (cache.gpu_bytes >> 20) << " MiB gpu, " << (cache.cpu_bytes >> 20)
+              << " MiB cpu, " << (cache.mapped_bytes >> 20) << " MiB mapped\n";
+    auto const images = luma::image_cache::shared().statistics();
+    std::cout << "image cache: " << images.hits << " hits, " << images.misses << " misses, "
+              << images.writes << " writes\n";
+    return 0;
+}
+
+// luma --encode [options] image...
+//   --quality fast|normal|high   default normal
+//   --out <dir>                  output directory, default .
+//   --no-mips                    level 0 only
+// Writes <name>.ktx with BC1, or BC3 for images with alpha. CPU only, no
+// context is created.
+static auto encode_textures(int32_t argc, char const* argv[]) -> int32_t {
+    auto quality = luma::bc::quality::normal;
+    std::filesystem::path out{"."};
+    auto is_mipmapped = true;
+    std::vector<std::string> images;
+    for (int32_t i = 0; i < argc; i++) {
+        auto const arg = std::string_view{argv[i]};
+        if ((arg == "--quality" || arg == "--out") && i + 1 >= argc)
+            throw std::runtime_error(std::string{"missing value for "} + argv[i]);
+        if (arg == "--quality") {
+            auto const level = std::string_view{argv[++i]};
+            if (level == "fast") quality = luma::bc::quality::fast;
+            else if (level == "normal") quality = luma::bc::quality::normal;
+            else if (level == "high") quality = luma::bc::quality::high;
+            else throw std::runtime_error("--quality expects fast, normal or high");
+        } else if (arg == "--out") {
+            out = argv[++i];
+        } else if (arg == "--no-mips") {
+            is_mipmapped = false;
+        } else if (arg.starts_with("--")) {
+            throw std::runtime_error(std::string{"unknown option "} + argv[i]);
+        } else {
+            images.emplace_back(arg);
+        }
+    }
+    if (images.empty()) throw std::runtime_error("no input images");
+    std::filesystem::create_directories(out);
+
+    int32_t failed = 0;
+    for (auto const& filename : images) {
+        luma::image source{filename};
+        if (!source.buffer()) {
+            std::cerr << "ERROR::ENCODE: Failed to load " << filename << '\n';
+            failed++;
+            continue;
+        }
+        if (luma::pixel::is_float(source.type())) {
+            std::cerr << "ERROR::ENCODE: BC1/BC3 cannot hold HDR, skipping " << filename << '\n';
+            failed++;
+            continue;
+        }
+        if (is_mipmapped) source.build_mips();
+        auto const start   = std::chrono::steady_clock::now();
+        auto const surface = luma::bc::encode(source, luma::bc::choose(source.is_opaque()), quality);
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        auto output = out / std::filesystem::path{filename}.stem();
+        output += ".ktx";
+        if (!luma::bc::save(surface, output.string())) {
+            std::cerr << "ERROR::ENCODE: Failed to write " << output << '\n';
+            failed++;
+            continue;
+        }
+        std::cout << output.string() << ": " << surface.levels.size() << " levels, " << surface.bytes()
+                  << " bytes, encoded in " << seconds << "s\n";
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+// luma --benchmark-resample [options]
+//   --size <w>x<h>     source size, default 10000x10000
+//   --to <w>x<h>       target size, default the source fitted in 2560
+//   --iterations <n>   runs per filter, the best is reported, default 3
+// Resizes random 8-bit RGBA with every filter, decode and encode included,
+// and reports megapixels per second read from the source.
+static auto benchmark_resample(int32_t argc, char const* argv[]) -> int32_t {
+    int32_t width = 10000, height = 10000, to_width = 0, to_height = 0, iterations = 3;
+    for (int32_t i = 0; i < argc; i++) {
+        auto const arg = std::string_view{argv[i]};
+        if (i + 1 >= argc) throw std::runtime_error(std::string{"missing value for "} + argv[i]);
+        if (arg == "--size") {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                throw std::runtime_error("--size expects <width>x<height>");
+        } else if (arg == "--to") {
+            if (std::sscanf(argv[++i], "%dx%d", &to_width, &to_height) != 2 || to_width <= 0 || to_height <= 0)
+                throw std::runtime_error("--to expects <width>x<height>");
+        } else if (arg == "--iterations") {
+            if (!parse_number(argv[++i], iterations) || iterations < 1)
+                throw std::runtime_error("--iterations expects a positive integer");
+        } else {
+            throw std::runtime_error(std::string{"unknown option "} + argv[i]);
+        }
+    }
+    if (to_width == 0) {
+        auto const size = luma::resample::fit(width, height, 2560);
+        to_width  = size.width;
+        to_height = size.height;
+    }
+
+    std::vector<luma::u8> source(luma::usize(width) * luma::usize(height) * 4);
+    std::mt19937 random{42};
+    for (auto& value : source) value = luma::u8(random());
+    std::vector<luma::u8> target(luma::usize(to_width) * luma::usize(to_height) * 4);
+
+    auto const megapixels = double(width) * double(height) / 1e6;
+    std::cout << width << "x" << height << " -> " << to_width << "x" << to_height << ", "
+              << std::max(std::thread::hardware_concurrency(), 1u) << " threads\n";
+    constexpr std::array filters{
+        std::pair{luma::resample::filter::box, "box"},
+        std::pair{luma::resample::filter::kaiser, "kaiser"},
+        std::pair{luma::resample::filter::lanczos, "lanczos"},
+        std::pair{luma::resample::filter::mitchell, "mitchell"},
+    };
+    for (auto const& [kind, name] : filters) {
+        auto best = std::numeric_limits<double>::max();
+        for (int32_t i = 0; i < iterations; i++) {
+            auto const start = std::chrono::steady_clock::now();
+            auto const level = luma::resample::resize(source.data(), width, height, 4, to_width, to_height, kind);
+            luma::resample::encode(level, 4, target.data());
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::printf("%-9s %8.3fs %9.1f MP/s\n", name, best, megapixels / best);
+    }
+    return 0;
+}
+
+auto main(int32_t argc, char const* argv[]) -> int32_t {
+    if (argc > 1 && std::string_view{argv[1]} == "--benchmark-resample") {
+        try {
+            return benchmark_resample(argc - 2, argv + 2);
+        } catch (std::exception const& e) {
+            std::cerr << "ERROR::BENCHMARK: " << e.what() << '\n';
+            return 1;
+        }
+    }
+    if (argc > 1 && std::string_view{argv[1]} == "--encode") {
+        try {
+            return encode_textures(argc - 2, argv + 2);
+        } catch (std::exception const& e) {
+            std::cerr << "ERROR::ENCODE: " << e.what() << '\n';
+            return 1;
+        }
+    }
+    if (argc > 1 && std::string_view{argv[1]} == "--headless") {
+        try {
+            return render_headless(parse_headless(argc - 2, argv + 2));
+        } catch (std::exception const& e) {
+            std::cerr << "ERROR::HEADLESS: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    // --threaded:   render on a dedicated thread, the main thread only polls
+    //                events and updates the camera. The ImGui overlay is
+    //                disabled then.
+    // --uncapped:    no vsync, no frame limit.
+    // --fps <rate>:  no vsync, frames limited to a fixed rate.
+    // --late-input:  with vsync, sample input as late as recent frames allow.
+    // Other arguments are images or directories of images, stepped through
+    // with the arrow keys, Home and End, with thumbnails along the bottom.
+    auto is_threaded   = false;
+    auto is_late_input = false;
+    auto pacing = luma::frame_pacer::mode::vsync;
+    auto rate   = 60.0;
+    std::vector<std::string> paths;
+    for (int32_t i = 1; i < argc; i++) {
+        auto const arg = std::string_view{argv[i]};
+        if (arg == "--threaded") is_threaded = true;
+        else if (arg == "--late-input") is_late_input = true;
+        else if (arg == "--uncapped") pacing = luma::frame_pacer::mode::uncapped;
+        else if (arg == "--fps") {
+            if (i + 1 >= argc || !parse_number(argv[++i], rate) || !std::isfinite(rate) || rate <= 0.0) {
+                std::cerr << "ERROR::MAIN: --fps expects a positive rate\n";
+                return 1;
+            }
+            pacing = luma::frame_pacer::mode::fixed;
+        } else if (!arg.starts_with("--")) {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.empty()) paths.emplace_back("/Users/k/Downloads/nurture.jpeg");
+
+    LUMA_PROFILE_THREAD("main");
     luma::window window{"Hello, Grid!", 1280, 720};
+    texture_cache_guard textures{};
     //window.position(luma::DONT_CARE, -800);
 
+    luma::frame_pacer pacer{};
+    pacer.set_mode(pacing, rate);
+    // Late input only helps when the thread that paces also samples input.
+    pacer.set_late_input(is_late_input && !is_threaded);
+    if (auto mode = glfwGetVideoMode(glfwGetPrimaryMonitor())) {
+        pacer.set_refresh_rate(mode->refreshRate);
+        // Nothing is shown larger than the screen.
+        luma::texture::set_max_size(std::max(mode->width, mode->height));
+    }
+
     int32_t width, height;
     glfwGetFramebufferSize(window.get_native(), &width, &height);
     int32_t w_width, w_height;
@@ -110,51 +537,36 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
     ImGui_ImplGlfw_InitForOpenGL(window.get_native(), true);
     ImGui_ImplOpenGL3_Init(luma::window::GLSL_VERSION);
 
-    luma::buffer::layout vertex_layout{
-        {luma::shader::type::vec3, "a_position"},
-        {luma::shader::type::vec4, "a_color"},
-        {luma::shader::type::vec2, "a_uv"},
-    };
     luma::shader shader{vertex_shader, fragment_shader};
     luma::shader screen_shader{screen_vertex_shader, screen_fragment_shader};
-    auto texture = luma::make_ref<luma::texture>("/Users/k/Downloads/nurture.jpeg");
-
-    auto plane = luma::mesh::plane();
-    auto plane_va = luma::buffer::array::create();
-    auto plane_vb = luma::buffer::vertex::create(plane->vertices().data(), plane->vertices_size());
-    auto plane_ib = luma::buffer::index::create(plane->indices().data(), plane->index_count());
-    plane_vb->set_layout(vertex_layout);
-    plane_va->add_vertex_buffer(plane_vb);
-    plane_va->set_index_buffer(plane_ib);
-
-    auto screen = luma::mesh::plane();
-    auto screen_va = luma::buffer::array::create();
-    auto screen_vb = luma::buffer::vertex::create(screen->vertices().data(), screen->vertex_count() * sizeof(luma::mesh::vertex));
-    auto screen_ib = luma::buffer::index::create(screen->indices().data(), screen->indices().size());
-    screen_vb->set_layout(vertex_layout);
-    screen_va->add_vertex_buffer(screen_vb);
-    screen_va->set_index_buffer(screen_ib);
-
-    auto framebuffer = luma::make_ref<luma::buffer::frame>();
-    uint32_t texture_render_buffer;
-    glGenTextures(1, &texture_render_buffer);
-    glBindTexture(GL_TEXTURE_2D, texture_render_buffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // attach it to currently bound framebuffer object
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_render_buffer, 0);
-    uint32_t render_buffer;
-    glGenRenderbuffers(1, &render_buffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, render_buffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, render_buffer);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cerr << "ERROR::FRAMEBUFFER: Framebuffer is not complete!\n";
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Decoded ahead on the workers, uploaded and swapped in by render_scene.
+    luma::sequence images{luma::sequence::expand(paths)};
+    luma::usize image_index = 0;
+    // Stops, `[` and `]` step it by half a stop and backslash resets.
+    float exposure = 0.0f;
+    // Thumbnails taken as images are decoded, T toggles the strip.
+    luma::filmstrip thumbnails{};
+    auto is_filmstrip = true;
+    images.on_decoded([&](luma::usize const& index, luma::image const& decoded) {
+        thumbnails.add(index, decoded, images.index());
+    });
+
+    // The textured plane and the screen quad share one set of buffers.
+    auto& primitives = luma::mesh::registry::shared();
+    auto plane  = primitives.plane();
+    auto screen = primitives.plane();
+
+    // Float, so HDR images keep what is past 1 until the exposure is applied.
+    auto framebuffer = luma::make_ref<luma::buffer::frame>(width, height, GL_RGBA16F);
     luma::grid grid_render{};
+    luma::render_queue queue{};
+    // Scene packets are recorded on the pool and merged on the GL thread.
+    luma::command_buffer scene{};
+    luma::gpu_profiler profiler{};
+    // F9 toggles recording the first pass to capture_<n>.y4m.
+    luma::local<luma::capture> recording;
+    auto is_recording = false;
+    auto recordings   = 0;
 
     bool is_cursor_on  = true;
     auto toggle_cursor = window.make_key(GLFW_KEY_ESCAPE);
@@ -170,7 +582,6 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
     auto pan_on  = window.make_key(GLFW_KEY_LEFT_SHIFT);
     auto zoom_on = window.make_key(GLFW_KEY_LEFT_CONTROL);
 
-    double time[2]{glfwGetTime(), 0};
     double delta_time = 0;
     //float camera_speed = 1.f;
 
@@ -222,6 +633,16 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
         auto evt = static_cast<luma::key_down_event const&>(e);
         std::cout << e.to_string() << "\n";
         if (evt.key() == GLFW_KEY_Q) is_running = false;
+        if (luma::profile::enabled && evt.key() == GLFW_KEY_F12) luma::profile::dump("luma_trace.json");
+        if (evt.key() == GLFW_KEY_F9 && !evt.is_repeat()) is_recording = !is_recording;
+        if (evt.key() == GLFW_KEY_T && !evt.is_repeat()) is_filmstrip = !is_filmstrip;
+        if (evt.key() == GLFW_KEY_RIGHT && image_index + 1 < images.size()) image_index++;
+        if (evt.key() == GLFW_KEY_LEFT && image_index > 0) image_index--;
+        if (evt.key() == GLFW_KEY_HOME) image_index = 0;
+        if (evt.key() == GLFW_KEY_END && images.size() > 0) image_index = images.size() - 1;
+        if (evt.key() == GLFW_KEY_LEFT_BRACKET) exposure -= 0.5f;
+        if (evt.key() == GLFW_KEY_RIGHT_BRACKET) exposure += 0.5f;
+        if (evt.key() == GLFW_KEY_BACKSLASH) exposure = 0.0f;
         if (evt.key() == GLFW_KEY_LEFT_SHIFT || evt.key() == GLFW_KEY_LEFT_CONTROL)
             arcball_on = false;
     };
@@ -246,14 +667,107 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
     //              - control+scroll
     //              - control+middle mouse
 
+    auto render_scene = [&](frame_snapshot const& frame) {
+        LUMA_PROFILE_SCOPE("render_scene");
+        profiler.begin_frame();
+        framebuffer->resize(frame.width, frame.height);
+
+        // FIRST PASS
+        profiler.begin("first pass");
+        framebuffer->bind();
+        glViewport(0, 0, frame.width, frame.height);
+        glClearColor(0.f, 0.f, 0.f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        //glEnable(GL_CULL_FACE);
+        //glCullFace(GL_FRONT);
+
+        images.seek(frame.image);
+        images.update();
+        luma::texture_cache::shared().update();
+        queue.begin(frame.view, frame.projection, frame.near_far);
+        scene.reset();
+        auto const texture = images.current();
+        luma::thread_pool::shared().parallel_for(0, 2, [&](luma::usize const& begin, luma::usize const& end) {
+            auto& list = scene.local();
+            for (auto i = begin; i < end; i++) {
+                if (i == 0 && texture) list.submit(plane_command(queue, shader, *texture, *plane, frame.model));
+                if (i == 1) grid_render.submit(list, 1);
+            }
+        });
+        scene.submit(queue);
+        queue.sort();
+        {
+            LUMA_GPU_SCOPE(profiler, "scene");
+            queue.execute(0);
+        }
+        {
+            LUMA_GPU_SCOPE(profiler, "grid");
+            queue.execute(1);
+        }
+        framebuffer->unbind();
+        profiler.end();
+
+        if (frame.is_recording) {
+            if (!recording) {
+                auto filename = "capture_" + std::to_string(recordings++) + ".y4m";
+                recording = luma::make_local<luma::capture>(filename, luma::capture::format::y4m);
+            }
+            recording->read(*framebuffer);
+        } else if (recording) {
+            recording.reset();
+        }
+
+        // SECOND PASS
+        LUMA_GPU_SCOPE(profiler, "screen blit");
+        glViewport(0, 0, frame.width, frame.height);
+        glClearColor(0.f, 0.f, 0.f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_DEPTH_TEST);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        screen_shader.bind();
+        screen_shader.num("u_texture", 0);
+        screen_shader.num("u_exposure", std::exp2(frame.exposure));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, framebuffer->color());
+
+        screen->bind();
+        glDrawElements(GL_TRIANGLES, screen->count(), GL_UNSIGNED_INT, 0);
+
+        if (frame.is_filmstrip) thumbnails.render(frame.image, images.size(), frame.width, frame.height);
+    };
+
+    // Threaded, the pacer belongs to the render thread and measures the frames shown.
+    luma::render_thread<frame_snapshot> renderer{window, [&](frame_snapshot const& frame) {
+        pacer.wait();
+        pacer.begin_frame();
+        render_scene(frame);
+        profiler.end_frame();
+        pacer.end_frame();
+    }};
+    if (is_threaded) renderer.start();
+    auto last_frame = std::chrono::steady_clock::now();
+
     while(is_running) {
+        LUMA_PROFILE_SCOPE("frame");
+        // Input is sampled after the pacing wait, right before the frame is built.
+        if (is_threaded) {
+            // The render thread paces, the next frame is built once it took the last one.
+            renderer.wait_taken();
+            window.poll();
+            auto const now = std::chrono::steady_clock::now();
+            delta_time = std::chrono::duration<double>(now - last_frame).count();
+            last_frame = now;
+        } else {
+            pacer.wait();
+            window.poll();
+            delta_time = pacer.begin_frame();
+        }
+
         glfwGetFramebufferSize(window.get_native(), &width, &height);
         glfwGetWindowSize(window.get_native(), &w_width, &w_height);
 
         is_running = !window.should_close();
-        time[1] = time[0];
-        time[0] = glfwGetTime();
-        delta_time = time[0] - time[1];
 
         mouse_previous = mouse_current;
         glfwGetCursorPos(window.get_native(), &mouse_current.x, &mouse_current.y);
@@ -267,75 +781,21 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
 
         camera.update_perspective(float(width) / float(height), 45.0f);
 
-        framebuffer->bind();
-        glBindTexture(GL_TEXTURE_2D, texture_render_buffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_render_buffer, 0);
-
-        glBindRenderbuffer(GL_RENDERBUFFER, render_buffer);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-        glBindRenderbuffer(GL_RENDERBUFFER, 0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, render_buffer);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cerr << "ERROR::FRAMEBUFFER: Framebuffer is not complete!\n";
-        framebuffer->unbind();
-
-        // FIRST PASS
-        framebuffer->bind();
-        glViewport(0, 0, width, height);
-        glClearColor(0.f, 0.f, 0.f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        //glEnable(GL_CULL_FACE);
-        //glCullFace(GL_FRONT);
-
-        shader.bind();
-        shader.num("u_texture", 0);
-        texture->bind(0);
-
         model = glm::mat4{1.0f};
         model = glm::translate(model, {0.0f, 1.f, 0.0f});
 
-        auto world_to_view = camera.world_to_view();
-        auto projection    = camera.projection();
-
-        shader.mat4("u_model", glm::value_ptr(model));
-        shader.mat4("u_view", glm::value_ptr(world_to_view));
-        shader.mat4("u_projection", glm::value_ptr(projection));
-
-        plane_va->bind();
-        plane_vb->bind();
-        plane_ib->bind();
-        glDrawElements(GL_TRIANGLES, plane_ib->count(), GL_UNSIGNED_INT, 0);
-
-        grid_render.render(world_to_view, projection,
-                           glm::vec2{camera.near, camera.far});
-        framebuffer->unbind();
-
-        // SECOND PASS
-        glViewport(0, 0, width, height);
-        glClearColor(0.f, 0.f, 0.f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDisable(GL_DEPTH_TEST);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-        screen_shader.bind();
-        screen_shader.num("u_texture", 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture_render_buffer);
-
-        screen_va->bind();
-        screen_vb->bind();
-        screen_ib->bind();
-        glDrawElements(GL_TRIANGLES, screen_ib->count(), GL_UNSIGNED_INT, 0);
+        frame_snapshot frame{
+            camera.world_to_view(), camera.projection(),
+            {camera.near, camera.far}, model, width, height, is_recording, image_index, exposure, is_filmstrip,
+        };
+        if (is_threaded) {
+            renderer.publish(frame);
+            continue;
+        }
+        render_scene(frame);
 
         // New Dear ImGui frame
+        LUMA_PROFILE_SCOPE("imgui");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -354,7 +814,7 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
         //ImGui::Begin("scene", nullptr, ImGuiWindowFlags_None | ImGuiWindowFlags_NoBringToFrontOnFocus);
         //ImGui::PopStyleVar(5);  // Apply style
         //scene_size = luma::imgui_window_size();
-        //ImGui::Image((void*)intptr_t(texture_render_buffer), ImVec2{scene_size.x, scene_size.y}, ImVec2{0, 1}, ImVec2{1, 0});
+        //ImGui::Image((void*)intptr_t(framebuffer->color()), ImVec2{scene_size.x, scene_size.y}, ImVec2{0, 1}, ImVec2{1, 0});
         //ImGui::End();
 
         //ImGui::Begin("property", nullptr, ImGuiWindowFlags_None);
@@ -364,10 +824,26 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
         //}
         //ImGui::End();
 
+        profiler.imgui();
+        pacer.imgui();
+
+        ImGui::Begin("images");
+        auto const prefetch = images.statistics();
+        ImGui::Text("%zu / %zu%s", images.index() + 1, images.size(),
+                    images.is_current_failed() ? " (failed)" : images.is_current_ready() ? "" : " (loading)");
+        ImGui::TextUnformatted(images.filename().c_str());
+        ImGui::Text("%zu held, %.1f MiB", prefetch.slots, double(prefetch.held_bytes) / double(1 << 20));
+        ImGui::Text("%llu decodes, %llu failed, %llu cancelled", (unsigned long long)prefetch.decodes,
+                    (unsigned long long)prefetch.failed, (unsigned long long)prefetch.cancelled);
+        ImGui::SliderFloat("exposure", &exposure, -8.0f, 8.0f, "%+.1f stops");
+        ImGui::End();
+
         ImGui::Render();
 
          // Begin ImGui Draw
+        profiler.begin("imgui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.end();
         if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
             auto backup_current = glfwGetCurrentContext();
             ImGui::UpdatePlatformWindows();
@@ -375,18 +851,25 @@ auto main([[maybe_unused]]int32_t argc, [[maybe_unused]]char const* argv[]) -> i
             glfwMakeContextCurrent(backup_current);
         }
 
+        profiler.end_frame();
+        pacer.end_frame();
+
         window.swap();
-        window.poll();
     }
+    renderer.stop();
+    if (is_threaded) {
+        // No overlay in threaded mode, report the render thread's pacing on exit.
+        auto const s = pacer.statistics();
+        std::printf("last %zu frames: avg %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms, %zu stutters\n",
+                    s.samples, s.avg, s.p50, s.p95, s.p99, s.max, s.stutters);
+    }
+    if (luma::profile::enabled) luma::profile::dump("luma_trace.json");
 
     // Dear ImGui cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    glDeleteTextures(1, &texture_render_buffer);
-    glDeleteRenderbuffers(1, &render_buffer);
-
     return 0;
 }
 
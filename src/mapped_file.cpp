@@ -0,0 +1,62 @@
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LUMA_MMAP
+#endif
+
+namespace luma {
+
+mapped_file::mapped_file(std::string const& filename) {
+#ifdef LUMA_MMAP
+    auto const fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info{};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        auto address = ::mmap(nullptr, usize(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            m_data = static_cast<u8*>(address);
+            m_size = usize(info.st_size);
+            m_is_mapped = true;
+        }
+    }
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+#else
+    std::ifstream file{filename, std::ios::binary | std::ios::ate};
+    if (!file) return;
+    m_size = usize(file.tellg());
+    m_data = new u8[m_size];
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(m_data), isize(m_size))) {
+        delete[] m_data;
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+}
+
+mapped_file::~mapped_file() {
+#ifdef LUMA_MMAP
+    if (m_is_mapped) ::munmap(m_data, m_size);
+#else
+    delete[] m_data;
+#endif
+}
+
+auto mapped_file::prefetch([[maybe_unused]] usize const& offset, [[maybe_unused]] usize const& size) const -> void {
+#ifdef LUMA_MMAP
+    if (!m_is_mapped || offset >= m_size) return;
+    auto const page  = usize(::sysconf(_SC_PAGESIZE));
+    auto const begin = offset / page * page;
+    ::madvise(m_data + begin, std::min(offset + size, m_size) - begin, MADV_WILLNEED);
+#endif
+}
+
+}
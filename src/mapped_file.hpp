@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// Private copy-on-write mapping of a whole file. Writes through data() only
+// touch this process' pages, never the file. POSIX only, on other platforms
+// the file is read into memory instead.
+class mapped_file {
+  public:
+    mapped_file(std::string const& filename);
+    ~mapped_file();
+    mapped_file(mapped_file const&) = delete;
+    auto operator=(mapped_file const&) -> mapped_file& = delete;
+
+    auto data() const -> u8* { return m_data; }
+    auto size() const -> usize { return m_size; }
+    auto is_open() const -> bool { return m_data != nullptr; }
+
+    // Ask the kernel to start reading [offset, offset + size) ahead of use.
+    auto prefetch(usize const& offset, usize const& size) const -> void;
+
+  private:
+    u8*   m_data = nullptr;
+    usize m_size = 0;
+    bool  m_is_mapped = false;
+};
+
+}
@@ -2,6 +2,10 @@
 #include <iostream>
 #include <array>
 #include <cmath>
+#include <algorithm>
+
+#include "thread_pool.hpp"
+#include "profile.hpp"
 
 namespace luma {
 namespace mesh {
@@ -31,6 +35,11 @@ auto surface::add_triangle(uint32_t const& offset, uint32_t const& v0, uint32_t
     }
 }
 
+auto surface::resize(usize const& vertex_count, usize const& index_count) -> void {
+    m_vertices.resize(vertex_count);
+    m_indices.resize(index_count);
+}
+
 auto surface::add_quad(uint32_t const& v0, uint32_t const& v1, uint32_t const& v2, uint32_t const& v3) -> void {
     m_faces.push_back({v0, v1, v2, v3});
 }
@@ -41,36 +50,80 @@ auto surface::add_vertex(glm::vec3 const& point, glm::vec4 const& color, glm::ve
     return m_vertices.size() - 1;
 }
 
-auto plane(int32_t const& resolution) -> ref<surface> {
-    auto mesh = make_ref<surface>();
-    glm::vec4 color{1.f, 0.f, 1.f, 1.f};
-    glm::vec3 point{-1.f, -1.f, 0.f};
+// Clamped so the indices stay below restart_index and the index count fits
+// the GLsizei of a draw call.
+static_assert(u64(max_plane_resolution + 1) * u64(max_plane_resolution + 1) < u64(restart_index));
+static_assert(u64(max_plane_resolution) * u64(max_plane_resolution) * 6 <= u64(max::i32));
+static_assert(u64(max_plane_resolution + 1) * u64(max_plane_resolution + 1) * 6 > u64(max::i32));
+static auto plane_resolution(int32_t const& resolution) -> uint32_t {
+    return uint32_t(std::clamp(resolution, 1, max_plane_resolution));
+}
 
-    for (auto i = 0; i < resolution + 1; i++) {
-        for (auto j = 0; j < resolution + 1; j++) {
-            mesh->add_vertex(point, color, {float(j) / resolution, float(i) / resolution});
-            point[0] += 2.0 / resolution;
+auto plane_size(int32_t const& resolution, mesh::topology const& topology) -> size {
+    auto const n = usize(plane_resolution(resolution));
+    if (topology == topology::triangle_strip)
+        return {(n + 1) * (n + 1), n * 2 * (n + 1) + (n - 1)};
+    return {(n + 1) * (n + 1), n * n * 6};
+}
 
+auto generate_plane(int32_t const& resolution, mesh::topology const& topology, vertex* vertices, uint32_t* indices) -> void {
+    LUMA_PROFILE_SCOPE("mesh::generate_plane");
+    auto const n = plane_resolution(resolution);
+    auto const step = 1.0f / float(n);
+    glm::vec4 const color{1.f, 0.f, 1.f, 1.f};
+
+    // Positions are derived from the row/column index instead of accumulated,
+    // so every row is independent and the far edge lands exactly on 1.
+    thread_pool::shared().parallel_for(0, n + 1, [&](usize const& begin, usize const& end) {
+        for (auto i = uint32_t(begin); i < end; i++) {
+            auto row = vertices + usize(i) * (n + 1);
+            auto const v = float(i) * step;
+            for (uint32_t j = 0; j < n + 1; j++) {
+                auto const u = float(j) * step;
+                row[j] = {{u * 2.f - 1.f, v * 2.f - 1.f, 0.f}, color, {u, v}};
+            }
         }
-        point[0] = -1.f;
-        point[1] += 2.0 / resolution;
-    }
-
-    uint32_t vertex_id = 0;
-    uint32_t offset = 0;
-    for (auto i = 0; i < resolution; i++) {
-        for (auto j = 0; j < resolution; j++) {
-            mesh->add_triangle(offset, vertex_id + 0, vertex_id + resolution + 1, vertex_id + 1);
-            mesh->add_triangle(offset + 3, vertex_id + 1, vertex_id + resolution + 1, vertex_id + resolution + 2);
-            vertex_id++;
-            offset += 6;
+    }, 64);
+
+    thread_pool::shared().parallel_for(0, n, [&](usize const& begin, usize const& end) {
+        for (auto i = uint32_t(begin); i < end; i++) {
+            auto const first = i * (n + 1);
+            if (topology == topology::triangle_strip) {
+                auto row = indices + usize(i) * (2 * (n + 1) + 1);
+                for (uint32_t j = 0; j < n + 1; j++) {
+                    row[j * 2 + 0] = first + j;
+                    row[j * 2 + 1] = first + j + n + 1;
+                }
+                if (i + 1 < n) row[2 * (n + 1)] = restart_index;
+            } else {
+                auto row = indices + usize(i) * n * 6;
+                for (uint32_t j = 0; j < n; j++) {
+                    auto const id = first + j;
+                    row[j * 6 + 0] = id;
+                    row[j * 6 + 1] = id + n + 1;
+                    row[j * 6 + 2] = id + 1;
+                    row[j * 6 + 3] = id + 1;
+                    row[j * 6 + 4] = id + n + 1;
+                    row[j * 6 + 5] = id + n + 2;
+                }
+            }
         }
-        vertex_id++;
-    }
+    }, 64);
+}
+
+auto plane(int32_t const& resolution, mesh::topology const& topology) -> ref<surface> {
+    if (resolution > max_plane_resolution)
+        std::cerr << "ERROR::MESH: Plane resolution " << resolution << " clamped to " << max_plane_resolution << '\n';
+    auto mesh = make_ref<surface>();
+    auto const count = plane_size(resolution, topology);
+    mesh->resize(count.vertices, count.indices);
+    mesh->set_topology(topology);
+    generate_plane(resolution, topology, mesh->vertex_data(), mesh->index_data());
     return mesh;
 }
 
 auto cube() -> ref<surface> {
+    LUMA_PROFILE_SCOPE("mesh::cube");
     auto mesh = make_ref<surface>();
     std::vector<vertex> vertices{
         {{-1.0f, -1.0f, -1.0f},  {1.0f, 0.0f, 0.0f, 1.0f},  {0.0f, 0.0f}},
@@ -11,6 +11,14 @@
 namespace luma {
 
 namespace mesh {
+// Index value that restarts a strip when GL_PRIMITIVE_RESTART is enabled.
+constexpr uint32_t restart_index = max::u32;
+
+enum class topology : uint32_t {
+    triangles,
+    triangle_strip,  // rows joined with restart_index
+};
+
 struct vertex {
     glm::vec3 position;
     glm::vec4 color;
@@ -26,6 +34,8 @@ class surface {
 
     auto set_vertices(std::vector<vertex> const& vertices) -> void;
     auto set_indices(std::vector<uint32_t> const& indices) -> void;
+    auto set_topology(mesh::topology const& topology) -> void { m_topology = topology; }
+    auto resize(usize const& vertex_count, usize const& index_count) -> void;
     auto add_triangle(uint32_t const& offset, uint32_t const& v0, uint32_t const& v1, uint32_t const& v2) -> void;
     auto add_quad(uint32_t const& v0, uint32_t const& v1, uint32_t const& v2, uint32_t const& v3) -> void;
 
@@ -33,20 +43,40 @@ class surface {
                     glm::vec2 const& uv = {0.f, 0.f}) -> uint32_t;
     auto vertices() const -> std::vector<vertex> const& { return m_vertices; }
     auto indices() const -> std::vector<uint32_t> const& { return m_indices; }
+    auto vertex_data() -> vertex* { return m_vertices.data(); }
+    auto index_data() -> uint32_t* { return m_indices.data(); }
+    auto topology() const -> mesh::topology { return m_topology; }
 
     auto vertex_size() const -> uint32_t { return sizeof(vertex); }
-    auto vertices_size() const -> uint32_t { return vertex_size() * vertex_size(); }
+    auto vertices_size() const -> usize { return usize(vertex_size()) * m_vertices.size(); }
     auto vertex_count() const -> int32_t { return m_vertices.size(); }
     auto index_count() const -> int32_t { return m_indices.size(); }
 
   private:
     std::vector<vertex> m_vertices;
     std::vector<uint32_t> m_indices;
+    mesh::topology        m_topology = topology::triangles;
 
     std::vector<std::vector<uint32_t>> m_faces;
 };
 
-auto plane(int32_t const& resolution = 1) -> ref<surface>;
+struct size {
+    usize vertices;
+    usize indices;
+};
+
+// Past it the plane's index count overflows a draw call, larger
+// resolutions are clamped to it.
+constexpr int32_t max_plane_resolution = 18918;
+
+// Exact vertex/index counts for a plane, so storage can be allocated (or
+// mapped) once before generate_plane fills it.
+auto plane_size(int32_t const& resolution, mesh::topology const& topology = topology::triangles) -> size;
+// Write a plane straight into caller owned storage, rows are generated in
+// parallel. Both pointers must hold at least plane_size(...) elements.
+auto generate_plane(int32_t const& resolution, mesh::topology const& topology, vertex* vertices, uint32_t* indices) -> void;
+
+auto plane(int32_t const& resolution = 1, mesh::topology const& topology = topology::triangles) -> ref<surface>;
 auto cube() -> ref<surface>;
 //auto box(float const& length, float const& width, float const& height) -> ref<mesh>;
 
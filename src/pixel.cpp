@@ -0,0 +1,384 @@
+#include "pixel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LUMA_PIXEL_SSE2
+#endif
+#if defined(LUMA_PIXEL_SSE2) && defined(__GNUC__)
+#include <tmmintrin.h>
+#define LUMA_PIXEL_SSSE3
+#include <immintrin.h>
+#define LUMA_PIXEL_F16C
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LUMA_PIXEL_NEON
+#endif
+
+namespace luma::pixel {
+
+#ifdef LUMA_PIXEL_SSSE3
+// The build targets baseline x86-64, SSSE3 shuffles are compiled per
+// function and only called when the CPU has them.
+static auto has_ssse3() -> bool {
+    static bool const supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+// Four pixels a step. The 16 byte load reads past the 12 bytes used, so stop
+// while a full load still fits in the source.
+__attribute__((target("ssse3")))
+static auto shuffle_rgb(u8 const* rgb, u8* out, usize const& count, bool const& is_bgra) -> usize {
+    auto const mask = is_bgra
+        ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+        : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    auto const alpha = _mm_set1_epi32(int32_t(0xff000000u));
+    usize i = 0;
+    for (; i + 6 <= count; i += 4) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(rgb + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static auto shuffle_red_blue(u8* pixels, usize const& count) -> usize {
+    auto const mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    usize i = 0;
+    for (; i + 4 <= count; i += 4) {
+        auto const p = reinterpret_cast<__m128i*>(pixels + i * 4);
+        _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+    }
+    return i;
+}
+#endif
+
+static auto expand_rgb(u8 const* rgb, u8* out, usize const& count, bool const& is_bgra) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_SSSE3)
+    if (has_ssse3()) i = shuffle_rgb(rgb, out, count, is_bgra);
+#elif defined(LUMA_PIXEL_NEON)
+    for (; i + 16 <= count; i += 16) {
+        auto const v = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t p;
+        p.val[0] = is_bgra ? v.val[2] : v.val[0];
+        p.val[1] = v.val[1];
+        p.val[2] = is_bgra ? v.val[0] : v.val[2];
+        p.val[3] = vdupq_n_u8(255);
+        vst4q_u8(out + i * 4, p);
+    }
+#endif
+    auto const r = is_bgra ? 2 : 0;
+    for (; i < count; i++) {
+        out[i * 4 + 0] = rgb[i * 3 + r];
+        out[i * 4 + 1] = rgb[i * 3 + 1];
+        out[i * 4 + 2] = rgb[i * 3 + 2 - r];
+        out[i * 4 + 3] = 255;
+    }
+}
+
+auto expand_rgba(u8 const* source, int32_t const& channels, u8* rgba, usize const& count) -> void {
+    switch (channels) {
+        case 1:
+            for (usize i = 0; i < count; i++) {
+                rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = source[i];
+                rgba[i * 4 + 3] = 255;
+            }
+            break;
+        case 2:
+            for (usize i = 0; i < count; i++) {
+                rgba[i * 4 + 0] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = source[i * 2];
+                rgba[i * 4 + 3] = source[i * 2 + 1];
+            }
+            break;
+        case 3:
+            expand_rgb(source, rgba, count, false);
+            break;
+        default:
+            std::memcpy(rgba, source, count * 4);
+            break;
+    }
+}
+
+auto rgb_to_bgra(u8 const* rgb, u8* bgra, usize const& count) -> void {
+    expand_rgb(rgb, bgra, count, true);
+}
+
+auto swap_red_blue(u8* pixels, usize const& count) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_SSSE3)
+    if (has_ssse3()) i = shuffle_red_blue(pixels, count);
+#elif defined(LUMA_PIXEL_NEON)
+    for (; i + 16 <= count; i += 16) {
+        auto p = vld4q_u8(pixels + i * 4);
+        std::swap(p.val[0], p.val[2]);
+        vst4q_u8(pixels + i * 4, p);
+    }
+#endif
+    for (; i < count; i++) std::swap(pixels[i * 4], pixels[i * 4 + 2]);
+}
+
+// x / 255 rounded, exact for every product of two bytes.
+static inline auto divide_255(u32 const& x) -> u8 {
+    auto const t = x + 128;
+    return u8((t + (t >> 8)) >> 8);
+}
+
+#ifdef LUMA_PIXEL_SSE2
+// Two pixels widened to 16 bits, alpha lanes multiply by 255 to stay as is.
+static inline auto premultiply_lanes(__m128i const& x) -> __m128i {
+    auto const alpha_lanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    auto a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_or_si128(_mm_andnot_si128(alpha_lanes, a), _mm_and_si128(alpha_lanes, _mm_set1_epi16(255)));
+    auto t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    t = _mm_add_epi16(t, _mm_srli_epi16(t, 8));
+    return _mm_srli_epi16(t, 8);
+}
+#endif
+
+#ifdef LUMA_PIXEL_NEON
+static inline auto divide_255(uint16x8_t const& x) -> uint8x8_t {
+    auto const t = vaddq_u16(x, vdupq_n_u16(128));
+    return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+static inline auto multiply(uint8x16_t const& c, uint8x16_t const& a) -> uint8x16_t {
+    return vcombine_u8(divide_255(vmull_u8(vget_low_u8(c), vget_low_u8(a))),
+                       divide_255(vmull_u8(vget_high_u8(c), vget_high_u8(a))));
+}
+#endif
+
+auto premultiply(u8* rgba, usize const& count) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_SSE2)
+    auto const zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        auto const p = reinterpret_cast<__m128i*>(rgba + i * 4);
+        auto const v = _mm_loadu_si128(p);
+        auto const lo = premultiply_lanes(_mm_unpacklo_epi8(v, zero));
+        auto const hi = premultiply_lanes(_mm_unpackhi_epi8(v, zero));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+#elif defined(LUMA_PIXEL_NEON)
+    for (; i + 16 <= count; i += 16) {
+        auto p = vld4q_u8(rgba + i * 4);
+        p.val[0] = multiply(p.val[0], p.val[3]);
+        p.val[1] = multiply(p.val[1], p.val[3]);
+        p.val[2] = multiply(p.val[2], p.val[3]);
+        vst4q_u8(rgba + i * 4, p);
+    }
+#endif
+    for (; i < count; i++) {
+        auto const a = u32(rgba[i * 4 + 3]);
+        for (usize c = 0; c < 3; c++) rgba[i * 4 + c] = divide_255(rgba[i * 4 + c] * a);
+    }
+}
+
+auto is_opaque(u8 const* rgba, usize const& count) -> bool {
+    // Plain loop, compilers vectorise the AND reduction.
+    u8 all = 255;
+    for (usize i = 0; i < count; i++) all &= rgba[i * 4 + 3];
+    return all == 255;
+}
+
+auto is_opaque(u16 const* rgba, usize const& count, u16 const& one) -> bool {
+    auto is_all = true;
+    for (usize i = 0; i < count; i++) is_all &= rgba[i * 4 + 3] == one;
+    return is_all;
+}
+
+// v / 257 rounded, written so no step overflows 16 bits.
+auto narrow(u16 const* source, u8* out, usize const& count) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_SSE2)
+    auto const half = _mm_set1_epi16(128);
+    auto const one  = _mm_set1_epi16(1);
+    for (; i + 16 <= count; i += 16) {
+        __m128i r[2];
+        for (usize k = 0; k < 2; k++) {
+            auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + k * 8));
+            auto const q = _mm_add_epi16(_mm_srli_epi16(v, 8), _mm_and_si128(_mm_srli_epi16(v, 7), one));
+            r[k] = _mm_srli_epi16(_mm_add_epi16(_mm_sub_epi16(v, q), half), 8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(r[0], r[1]));
+    }
+#elif defined(LUMA_PIXEL_NEON)
+    for (; i + 8 <= count; i += 8) {
+        auto const v = vld1q_u16(source + i);
+        auto const q = vaddq_u16(vshrq_n_u16(v, 8), vandq_u16(vshrq_n_u16(v, 7), vdupq_n_u16(1)));
+        vst1_u8(out + i, vshrn_n_u16(vaddq_u16(vsubq_u16(v, q), vdupq_n_u16(128)), 8));
+    }
+#endif
+    for (; i < count; i++) {
+        auto const v = u32(source[i]);
+        out[i] = u8((v - ((v >> 8) + ((v >> 7) & 1)) + 128) >> 8);
+    }
+}
+
+static auto srgb_decode(f64 const& c) -> f64 {
+    return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+static auto decode_table() -> std::array<f32, 256> const& {
+    static auto const table = [] {
+        std::array<f32, 256> result{};
+        for (usize i = 0; i < result.size(); i++) result[i] = f32(srgb_decode(f64(i) / 255.0));
+        return result;
+    }();
+    return table;
+}
+
+// Linear value halfway between neighbouring codes, in sRGB space, so a
+// search gives exactly the rounded encoding without calling pow per sample.
+static auto encode_table() -> std::array<f32, 255> const& {
+    static auto const table = [] {
+        std::array<f32, 255> result{};
+        for (usize i = 0; i < result.size(); i++) result[i] = f32(srgb_decode((f64(i) + 0.5) / 255.0));
+        return result;
+    }();
+    return table;
+}
+
+auto to_linear(u8 const& srgb) -> f32 {
+    return decode_table()[srgb];
+}
+
+auto to_srgb(f32 const& linear) -> u8 {
+    auto const& table = encode_table();
+    int32_t code = 0;
+    for (int32_t step = 128; step > 0; step >>= 1)
+        if (code + step <= 255 && linear >= table[usize(code + step - 1)]) code += step;
+    return u8(code);
+}
+
+auto srgb_to_linear(u8 const* srgb, f32* linear, usize const& count) -> void {
+    auto const& table = decode_table();
+    for (usize i = 0; i < count; i++) linear[i] = table[srgb[i]];
+}
+
+auto linear_to_srgb(f32 const* linear, u8* srgb, usize const& count) -> void {
+    for (usize i = 0; i < count; i++) srgb[i] = to_srgb(linear[i]);
+}
+
+static auto srgb_encode(f64 const& c) -> f64 {
+    return c <= 0.0031308 ? c * 12.92 : 1.055 * std::pow(c, 1.0 / 2.4) - 0.055;
+}
+
+auto srgb16_to_linear(u16 const* srgb, f32* linear, usize const& count) -> void {
+    static auto const table = [] {
+        std::vector<f32> result(65536);
+        for (usize i = 0; i < result.size(); i++) result[i] = f32(srgb_decode(f64(i) / 65535.0));
+        return result;
+    }();
+    for (usize i = 0; i < count; i++) linear[i] = table[srgb[i]];
+}
+
+auto linear_to_srgb16(f32 const* linear, u16* srgb, usize const& count) -> void {
+    for (usize i = 0; i < count; i++)
+        srgb[i] = u16(std::lround(srgb_encode(std::clamp(f64(linear[i]), 0.0, 1.0)) * 65535.0));
+}
+
+static auto half_of(f32 const& value) -> u16 {
+    u32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    auto const sign      = u16((bits >> 16) & 0x8000);
+    auto const magnitude = bits & 0x7fffffff;
+    if (magnitude > 0x7f800000) return u16(sign | 0x7e00);
+    if (magnitude >= 0x47800000) return u16(sign | 0x7c00);
+    // Subnormal halves are multiples of 2^-24, the product is exact.
+    if (magnitude < 0x38800000) return u16(sign | u16(std::nearbyint(std::fabs(value) * 16777216.0f)));
+    // Rebias the exponent, the carry of the rounding may reach infinity.
+    auto const rounded = magnitude + 0xfff + ((magnitude >> 13) & 1);
+    return u16(sign | ((rounded - 0x38000000) >> 13));
+}
+
+static auto float_of(u16 const& half) -> f32 {
+    auto const exponent = u32(half >> 10) & 0x1f;
+    auto const mantissa = u32(half) & 0x3ff;
+    if (exponent == 0) {
+        auto const value = f32(mantissa) / 16777216.0f;
+        return half & 0x8000 ? -value : value;
+    }
+    auto const bits = (u32(half & 0x8000) << 16)
+                    | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+    f32 value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#ifdef LUMA_PIXEL_F16C
+static auto has_f16c() -> bool {
+    static bool const supported = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+__attribute__((target("avx,f16c")))
+static auto convert_to_half(f32 const* source, u16* half, usize const& count) -> usize {
+    usize i = 0;
+    for (; i + 8 <= count; i += 8) {
+        auto const v = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(half + i), v);
+    }
+    return i;
+}
+
+__attribute__((target("avx,f16c")))
+static auto convert_from_half(u16 const* half, f32* out, usize const& count) -> usize {
+    usize i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(half + i))));
+    return i;
+}
+#endif
+
+auto to_half(f32 const* source, u16* half, usize const& count) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_F16C)
+    if (has_f16c()) i = convert_to_half(source, half, count);
+#elif defined(LUMA_PIXEL_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4)
+        vst1_u16(half + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(source + i))));
+#endif
+    for (; i < count; i++) half[i] = half_of(source[i]);
+}
+
+auto from_half(u16 const* half, f32* out, usize const& count) -> void {
+    usize i = 0;
+#if defined(LUMA_PIXEL_F16C)
+    if (has_f16c()) i = convert_from_half(half, out, count);
+#elif defined(LUMA_PIXEL_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(half + i))));
+#endif
+    for (; i < count; i++) out[i] = float_of(half[i]);
+}
+
+auto has_negative(u16 const* half, usize const& count) -> bool {
+    // -0 doesn't count, NaNs do whatever their sign.
+    auto is_any = false;
+    for (usize i = 0; i < count; i++) is_any |= (half[i] & 0x8000) && (half[i] & 0x7fff);
+    return is_any;
+}
+
+auto flip_rows(u8* pixels, usize const& stride, int32_t const& height) -> void {
+    // Through a small buffer, memcpy beats a byte-wise swap by a wide margin.
+    u8 buffer[4096];
+    for (int32_t y = 0; y < height / 2; y++) {
+        auto top    = pixels + usize(y) * stride;
+        auto bottom = pixels + usize(height - 1 - y) * stride;
+        for (usize x = 0; x < stride; x += sizeof(buffer)) {
+            auto const n = std::min(sizeof(buffer), stride - x);
+            std::memcpy(buffer, top + x, n);
+            std::memcpy(top + x, bottom + x, n);
+            std::memcpy(bottom + x, buffer, n);
+        }
+    }
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include "luma.hpp"
+
+// Pixel format conversions for loading and upload. Counts are in pixels
+// unless noted, every function is reentrant and source and destination must
+// not overlap. SSSE3 is picked at runtime on x86, NEON on ARM, with a scalar
+// path for the rest.
+namespace luma::pixel {
+
+// How an image stores its samples. Integers are sRGB encoded with linear
+// alpha, floats are linear light and may go past 1. Halves are IEEE binary16
+// kept in a u16.
+enum class type : uint8_t {
+    u8,
+    u16,
+    f16,
+    f32,
+};
+
+constexpr auto sample_size(type const& kind) -> usize {
+    return kind == type::u8 ? 1 : kind == type::f32 ? 4 : 2;
+}
+constexpr auto is_float(type const& kind) -> bool {
+    return kind == type::f16 || kind == type::f32;
+}
+
+// 1, 2 or 3 channels to RGBA, gray is replicated and missing alpha is opaque.
+// 4 channels is a copy.
+auto expand_rgba(u8 const* source, int32_t const& channels, u8* rgba, usize const& count) -> void;
+auto rgb_to_bgra(u8 const* rgb, u8* bgra, usize const& count) -> void;
+// RGBA <-> BGRA, in place.
+auto swap_red_blue(u8* pixels, usize const& count) -> void;
+
+// Straight to premultiplied alpha, in place, rounded to nearest.
+auto premultiply(u8* rgba, usize const& count) -> void;
+auto is_opaque(u8 const* rgba, usize const& count) -> bool;
+// `one` is the alpha of an opaque pixel, 0xffff for u16 and 0x3c00 for f16.
+auto is_opaque(u16 const* rgba, usize const& count, u16 const& one) -> bool;
+
+// 16-bit samples to 8-bit, rounded, `count` in samples.
+auto narrow(u16 const* source, u8* out, usize const& count) -> void;
+
+// Table driven, `count` in samples. Alpha is linear, convert colour only.
+auto to_linear(u8 const& srgb) -> f32;
+auto to_srgb(f32 const& linear) -> u8;
+auto srgb_to_linear(u8 const* srgb, f32* linear, usize const& count) -> void;
+auto linear_to_srgb(f32 const* linear, u8* srgb, usize const& count) -> void;
+// 16-bit codes, a 64K entry table one way and pow the other.
+auto srgb16_to_linear(u16 const* srgb, f32* linear, usize const& count) -> void;
+auto linear_to_srgb16(f32 const* linear, u16* srgb, usize const& count) -> void;
+
+// Rounded to nearest even, overflow goes to infinity, `count` in samples.
+// F16C is picked at runtime on x86, NEON on 64-bit ARM.
+auto to_half(f32 const* source, u16* half, usize const& count) -> void;
+auto from_half(u16 const* half, f32* out, usize const& count) -> void;
+// Some sample is below zero, which unsigned float formats can't hold.
+auto has_negative(u16 const* half, usize const& count) -> bool;
+
+// Reverses row order in place, `stride` in bytes.
+auto flip_rows(u8* pixels, usize const& stride, int32_t const& height) -> void;
+
+}
@@ -0,0 +1,124 @@
+#include "pixel_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define LUMA_HUGE_PAGES
+#endif
+
+namespace luma {
+
+namespace {
+constexpr usize CACHE_LINE = 64;
+constexpr usize PAGE       = 4096;
+constexpr usize PAGE_FROM  = usize(64) << 10;
+#ifdef LUMA_HUGE_PAGES
+constexpr usize HUGE_FROM  = usize(2) << 20;
+#endif
+
+auto alignment(usize const& size) -> usize {
+    return size >= PAGE_FROM ? PAGE : CACHE_LINE;
+}
+}
+
+pixel_pool::pixel_pool(usize const& cache_limit, bool const& huge_pages)
+    : m_cache_limit(cache_limit), m_is_huge(huge_pages) {
+#ifndef LUMA_HUGE_PAGES
+    m_is_huge = false;
+#endif
+}
+
+pixel_pool::~pixel_pool() {
+    trim();
+}
+
+auto pixel_pool::capacity(usize const& size) -> usize {
+    if (size <= CACHE_LINE) return CACHE_LINE;
+    // Four steps between powers of two.
+    auto const base = std::bit_floor(size - 1);
+    auto const step = std::max(base / 4, CACHE_LINE);
+    return (size + step - 1) / step * step;
+}
+
+auto pixel_pool::acquire(usize const& size) -> u8* {
+    auto const bytes = capacity(size);
+    {
+        std::lock_guard lock{m_mutex};
+        m_stats.live_bytes += bytes;
+        auto it = m_free.find(bytes);
+        if (it != std::end(m_free) && !it->second.empty()) {
+            auto buffer = it->second.back();
+            it->second.pop_back();
+            m_stats.cached_bytes -= bytes;
+            m_stats.reuses++;
+            return buffer;
+        }
+        m_stats.allocations++;
+    }
+    return allocate(bytes);
+}
+
+auto pixel_pool::release(u8* buffer, usize const& size) -> void {
+    if (!buffer) return;
+    auto const bytes = capacity(size);
+    {
+        std::lock_guard lock{m_mutex};
+        m_stats.live_bytes -= bytes;
+        if (m_stats.cached_bytes + bytes <= m_cache_limit) {
+            m_free[bytes].push_back(buffer);
+            m_stats.cached_bytes += bytes;
+            return;
+        }
+    }
+    deallocate(buffer, bytes);
+}
+
+auto pixel_pool::trim() -> void {
+    std::unordered_map<usize, std::vector<u8*>> cached;
+    {
+        std::lock_guard lock{m_mutex};
+        cached.swap(m_free);
+        m_stats.cached_bytes = 0;
+    }
+    for (auto const& [bytes, buffers] : cached)
+        for (auto buffer : buffers) deallocate(buffer, bytes);
+}
+
+auto pixel_pool::statistics() const -> stats {
+    std::lock_guard lock{m_mutex};
+    return m_stats;
+}
+
+auto pixel_pool::allocate(usize const& size) -> u8* {
+#ifdef LUMA_HUGE_PAGES
+    if (m_is_huge && size >= HUGE_FROM) {
+        auto address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED) throw std::bad_alloc{};
+        // Only advice, the kernel may still back it with small pages.
+        ::madvise(address, size, MADV_HUGEPAGE);
+        return static_cast<u8*>(address);
+    }
+#endif
+    return static_cast<u8*>(::operator new(size, std::align_val_t{alignment(size)}));
+}
+
+auto pixel_pool::deallocate(u8* buffer, usize const& size) -> void {
+#ifdef LUMA_HUGE_PAGES
+    if (m_is_huge && size >= HUGE_FROM) {
+        ::munmap(buffer, size);
+        return;
+    }
+#endif
+    ::operator delete(buffer, std::align_val_t{alignment(size)});
+}
+
+auto pixel_pool::shared() -> pixel_pool& {
+    // Leaked on purpose, images in other statics release into it at exit.
+    static auto instance = new pixel_pool{usize(256) << 20, true};
+    return *instance;
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "luma.hpp"
+
+namespace luma {
+
+// Recycles pixel buffers between images. Sizes are rounded up to classes,
+// four per power of two so at most a quarter is wasted, and released buffers
+// wait on a per class free list for the next image of a similar size. Up to
+// `cache_limit` bytes are kept, anything past that goes back to the system.
+//
+// Buffers are 64-byte aligned, page aligned from 64 KiB. With `huge_pages`,
+// classes of 2 MiB and up are mapped separately and advised as transparent
+// huge pages, Linux only.
+class pixel_pool {
+  public:
+    struct stats {
+        u64   allocations;  // from the system
+        u64   reuses;       // from a free list
+        usize live_bytes;
+        usize cached_bytes;
+    };
+
+  public:
+    pixel_pool(usize const& cache_limit = usize(256) << 20, bool const& huge_pages = false);
+    ~pixel_pool();
+    pixel_pool(pixel_pool const&) = delete;
+    auto operator=(pixel_pool const&) -> pixel_pool& = delete;
+
+    // At least `size` bytes, capacity(size) in fact. Release with the same size.
+    auto acquire(usize const& size) -> u8*;
+    auto release(u8* buffer, usize const& size) -> void;
+    // Returns every cached buffer to the system.
+    auto trim() -> void;
+
+    auto statistics() const -> stats;
+
+    static auto capacity(usize const& size) -> usize;
+    static auto shared() -> pixel_pool&;
+
+  private:
+    auto allocate(usize const& size) -> u8*;
+    auto deallocate(u8* buffer, usize const& size) -> void;
+
+  private:
+    mutable std::mutex m_mutex;
+    usize m_cache_limit;
+    bool  m_is_huge;
+    std::unordered_map<usize, std::vector<u8*>> m_free;
+    stats m_stats{};
+};
+
+}
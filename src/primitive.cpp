@@ -0,0 +1,69 @@
+#include "primitive.hpp"
+#include "glad/glad.h"
+
+#include <algorithm>
+
+namespace luma {
+namespace mesh {
+
+primitive::primitive(ref<surface const> const& surface) : m_surface(surface) {
+    m_array         = buffer::array::create();
+    m_vertex_buffer = buffer::vertex::create(surface->vertices().data(), surface->vertices_size());
+    m_index_buffer  = buffer::index::create(surface->indices().data(), surface->index_count());
+    m_array->add_vertex_buffer(m_vertex_buffer, vertex_format);
+    m_array->set_index_buffer(m_index_buffer);
+}
+
+auto primitive::bind() const -> void {
+    m_array->bind();
+}
+
+auto key_hash::operator()(key const& key) const -> usize {
+    auto hash = std::hash<std::string>{}(key.generator);
+    for (auto const& param : key.params)
+        hash ^= std::hash<int32_t>{}(param) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+auto registry::get(key const& key, generator_fn const& generate) -> ref<primitive> {
+    std::lock_guard lock{m_mutex};
+    auto it = m_primitives.find(key);
+    if (it != m_primitives.end()) {
+        if (auto shared = it->second.lock()) return shared;
+    }
+
+    ref<surface const> surface = generate();
+    auto shared = make_ref<primitive>(surface);
+    m_primitives[key] = shared;
+    return shared;
+}
+
+auto registry::plane(int32_t const& resolution, mesh::topology const& topology) -> ref<primitive> {
+    return get({"plane", {resolution, int32_t(topology)}}, [&] {
+        return mesh::plane(resolution, topology);
+    });
+}
+
+auto registry::cube() -> ref<primitive> {
+    return get({"cube"}, [] { return mesh::cube(); });
+}
+
+auto registry::collect() -> usize {
+    std::lock_guard lock{m_mutex};
+    return std::erase_if(m_primitives, [](auto const& pair) {
+        return pair.second.expired();
+    });
+}
+
+auto registry::size() const -> usize {
+    std::lock_guard lock{m_mutex};
+    return m_primitives.size();
+}
+
+auto registry::shared() -> registry& {
+    static registry instance{};
+    return instance;
+}
+
+}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+
+#include "luma.hpp"
+#include "buffer.hpp"
+#include "mesh.hpp"
+
+namespace luma {
+
+namespace mesh {
+
+inline constexpr auto vertex_format = buffer::make_format<vertex>(
+    LUMA_ATTRIBUTE(vertex, position),
+    LUMA_ATTRIBUTE(vertex, color),
+    LUMA_ATTRIBUTE(vertex, uv)
+);
+static_assert(vertex_format.stride == sizeof(vertex));
+static_assert(vertex_format.is_packed(), "mesh::vertex members and vertex_format are out of sync");
+
+// Immutable surface together with the GPU buffers it was uploaded to.
+class primitive {
+  public:
+    primitive(ref<surface const> const& surface);
+    ~primitive() = default;
+
+    auto get_surface() const -> ref<surface const> const& { return m_surface; }
+    auto get_array() const -> ref<buffer::array> const& { return m_array; }
+    auto get_vertex_buffer() const -> ref<buffer::vertex> const& { return m_vertex_buffer; }
+    auto get_index_buffer() const -> ref<buffer::index> const& { return m_index_buffer; }
+    auto count() const -> uint32_t { return m_index_buffer->count(); }
+    auto bind() const -> void;
+
+  private:
+    ref<surface const>  m_surface;
+    ref<buffer::array>  m_array;
+    ref<buffer::vertex> m_vertex_buffer;
+    ref<buffer::index>  m_index_buffer;
+};
+
+// Generator name plus its parameters, e.g. {"plane", {resolution, topology}}.
+struct key {
+    std::string            generator;
+    std::array<int32_t, 4> params{};
+
+    auto operator==(key const& other) const -> bool = default;
+};
+
+struct key_hash {
+    auto operator()(key const& key) const -> usize;
+};
+
+// Hands out shared primitives so identical geometry is generated and uploaded
+// once. Only weak references are kept, a primitive is freed as soon as the
+// last user drops it and collect() forgets the stale entry.
+class registry {
+  public:
+    using generator_fn = std::function<ref<surface>()>;
+
+  public:
+    registry() = default;
+    ~registry() = default;
+
+    auto get(key const& key, generator_fn const& generate) -> ref<primitive>;
+    auto plane(int32_t const& resolution = 1, mesh::topology const& topology = topology::triangles) -> ref<primitive>;
+    auto cube() -> ref<primitive>;
+
+    auto collect() -> usize;
+    auto size() const -> usize;
+
+    static auto shared() -> registry&;
+
+  private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<key, std::weak_ptr<primitive>, key_hash> m_primitives;
+};
+
+}
+
+}
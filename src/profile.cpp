@@ -0,0 +1,222 @@
+#include "profile.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace luma::profile {
+
+namespace {
+// Fields are atomic so dump() may read a block its owner is overwriting,
+// relaxed stores cost the same as plain ones.
+struct event {
+    std::atomic<char const*> name{nullptr};
+    std::atomic<u64>         begin{0};
+    std::atomic<u64>         end{0};
+};
+
+// Each thread appends to its own chain of blocks and publishes with a release
+// store of the count, so recording never takes a lock and dump() can read the
+// chain while the owner keeps writing. The blocks of all threads come out of
+// one budget, once it is spent a full thread reuses its oldest block, so a
+// trace keeps the latest events however long the session ran.
+constexpr usize block_events = 4096;
+constexpr usize max_blocks   = 128;     // 12 MiB of events across all threads
+
+struct block {
+    std::array<event, block_events> events;
+    std::atomic<u32>    count{0};
+    // Bumped when the block is reused, dump() skips a block that changed
+    // while it was being read.
+    std::atomic<u32>    generation{0};
+    std::atomic<block*> next{nullptr};
+};
+
+struct thread_buffer {
+    u32                      id;
+    std::atomic<char const*> name{nullptr};
+    std::atomic<block*>      oldest{nullptr};
+    std::vector<local<block>> blocks;      // owner thread only
+
+    thread_buffer(u32 const& id) : id(id) {}
+};
+
+struct registry {
+    std::mutex                         mutex;
+    std::vector<local<thread_buffer>>  buffers;
+    std::atomic<usize>                 blocks{0};
+    std::atomic<u64>                   overwritten{0};
+    u64                                epoch = now();
+};
+
+// Leaked on purpose, worker threads may still record during static destruction.
+auto get_registry() -> registry& {
+    static auto instance = new registry{};
+    return *instance;
+}
+
+struct writer {
+    thread_buffer* buffer = nullptr;
+    block*         tail   = nullptr;
+};
+
+// A thread's first block is always granted, the budget only limits growth.
+auto grow(thread_buffer& buffer) -> block* {
+    auto& reg = get_registry();
+    if (!buffer.blocks.empty() && reg.blocks.fetch_add(1, std::memory_order_relaxed) >= max_blocks) {
+        reg.blocks.fetch_sub(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    if (buffer.blocks.empty()) reg.blocks.fetch_add(1, std::memory_order_relaxed);
+    buffer.blocks.push_back(make_local<block>());
+    return buffer.blocks.back().get();
+}
+
+auto get_writer() -> writer& {
+    thread_local writer local{};
+    if (!local.buffer) {
+        auto& reg = get_registry();
+        {
+            std::lock_guard lock{reg.mutex};
+            reg.buffers.push_back(make_local<thread_buffer>(u32(reg.buffers.size() + 1)));
+            local.buffer = reg.buffers.back().get();
+        }
+        local.tail = grow(*local.buffer);
+        local.buffer->oldest.store(local.tail, std::memory_order_release);
+    }
+    return local;
+}
+
+// Unlinks the oldest block and resets it, readers still on it see the
+// generation change.
+auto recycle(writer& w) -> block* {
+    auto& buffer = *w.buffer;
+    auto const old = buffer.oldest.load(std::memory_order_relaxed);
+    get_registry().overwritten.fetch_add(old->count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (old != w.tail) {
+        buffer.oldest.store(old->next.load(std::memory_order_relaxed), std::memory_order_release);
+        old->next.store(nullptr, std::memory_order_relaxed);
+    }
+    old->generation.store(old->generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    old->count.store(0, std::memory_order_relaxed);
+    // Orders the generation before the events written into the block next.
+    std::atomic_thread_fence(std::memory_order_release);
+    return old;
+}
+
+struct event_copy {
+    char const* name;
+    u64         begin;
+    u64         end;
+};
+
+auto write_string(std::ostream& out, char const* text) -> void {
+    out << '"';
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') out << '\\';
+        out << *text;
+    }
+    out << '"';
+}
+}
+
+auto now() -> u64 {
+    using namespace std::chrono;
+    return u64(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+auto record(char const* name, u64 const& begin, u64 const& end) -> void {
+    auto& w = get_writer();
+    auto count = w.tail->count.load(std::memory_order_relaxed);
+    if (count == block_events) {
+        auto next = grow(*w.buffer);
+        if (!next) next = recycle(w);
+        if (next != w.tail) {
+            w.tail->next.store(next, std::memory_order_release);
+            w.tail = next;
+        }
+        count = 0;
+    }
+    auto& e = w.tail->events[count];
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin.store(begin, std::memory_order_relaxed);
+    e.end.store(end, std::memory_order_relaxed);
+    w.tail->count.store(count + 1, std::memory_order_release);
+}
+
+auto set_thread_name(char const* name) -> void {
+    get_writer().buffer->name.store(name);
+}
+
+auto overwritten() -> u64 {
+    return get_registry().overwritten.load(std::memory_order_relaxed);
+}
+
+auto dump(std::filesystem::path const& path) -> bool {
+    std::ofstream file{path};
+    if (!file) {
+        std::cerr << "ERROR::PROFILE: Failed to open " << path << '\n';
+        return false;
+    }
+
+    auto& reg = get_registry();
+    std::vector<thread_buffer*> buffers;
+    {
+        std::lock_guard lock{reg.mutex};
+        for (auto const& buffer : reg.buffers) buffers.push_back(buffer.get());
+    }
+
+    // Timestamps are microseconds since tracing started.
+    auto const epoch = i64(reg.epoch);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    auto first = true;
+    auto separator = [&] {
+        file << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (auto const& buffer : buffers) {
+        if (auto name = buffer->name.load()) {
+            separator();
+            file << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+            write_string(file, name);
+            file << "}}";
+        }
+        // A block reused while it is read is skipped, its events are newer
+        // than the dump anyway.
+        std::vector<event_copy> events;
+        for (auto it = buffer->oldest.load(std::memory_order_acquire); it; it = it->next.load(std::memory_order_acquire)) {
+            auto const generation = it->generation.load(std::memory_order_acquire);
+            auto const count = it->count.load(std::memory_order_acquire);
+            events.clear();
+            for (u32 i = 0; i < count; i++) {
+                auto const& e = it->events[i];
+                events.push_back({e.name.load(std::memory_order_relaxed), e.begin.load(std::memory_order_relaxed),
+                                  e.end.load(std::memory_order_relaxed)});
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (it->generation.load(std::memory_order_relaxed) != generation) continue;
+
+            for (auto const& e : events) {
+                separator();
+                file << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"name\":";
+                write_string(file, e.name);
+                file << ",\"ts\":" << f64(i64(e.begin) - epoch) * 1e-3
+                     << ",\"dur\":" << f64(e.end - e.begin) * 1e-3 << '}';
+            }
+        }
+    }
+    file << "\n]}\n";
+
+    if (auto const lost = overwritten())
+        std::cout << "luma::profile: " << lost << " older events were overwritten, the trace holds the latest\n";
+    return bool(file);
+}
+
+}
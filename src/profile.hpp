@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#include "luma.hpp"
+
+// CPU scope tracing, written out in the Chrome trace event format so a dump
+// opens in chrome://tracing or ui.perfetto.dev. Build with -DLUMA_PROFILE to
+// record, otherwise the macros below expand to nothing.
+namespace luma::profile {
+
+#ifdef LUMA_PROFILE
+constexpr auto enabled = true;
+#else
+constexpr auto enabled = false;
+#endif
+
+// Nanoseconds on the steady clock.
+auto now() -> u64;
+
+// Name must outlive the dump, string literals and __func__ are fine.
+auto record(char const* name, u64 const& begin, u64 const& end) -> void;
+auto set_thread_name(char const* name) -> void;
+
+// Safe to call while other threads keep recording, events that land during
+// the dump are picked up by the next one.
+auto dump(std::filesystem::path const& path) -> bool;
+
+// Events given up to make room since tracing started. The buffers of all
+// threads share a fixed budget, once it is spent each thread overwrites its
+// oldest events, so a dump holds the latest ones.
+auto overwritten() -> u64;
+
+class scope {
+  public:
+    scope(char const* name) : m_name(name), m_begin(now()) {}
+    ~scope() { record(m_name, m_begin, now()); }
+    scope(scope const&) = delete;
+    auto operator=(scope const&) -> scope& = delete;
+
+  private:
+    char const* m_name;
+    u64         m_begin;
+};
+
+}
+
+#ifdef LUMA_PROFILE
+#define LUMA_PROFILE_SCOPE(name) luma::profile::scope LUMA_CONCAT(luma_profile_scope_, __LINE__){name}
+#define LUMA_PROFILE_FUNCTION() LUMA_PROFILE_SCOPE(__func__)
+#define LUMA_PROFILE_THREAD(name) luma::profile::set_thread_name(name)
+#else
+#define LUMA_PROFILE_SCOPE(name) ((void)0)
+#define LUMA_PROFILE_FUNCTION() ((void)0)
+#define LUMA_PROFILE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,210 @@
+#include "render_queue.hpp"
+#include "command_list.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+#include "glad/glad.h"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace luma {
+
+render_queue::render_queue(usize const& capacity) {
+    m_commands.reserve(capacity);
+    m_keys.reserve(capacity);
+    m_order.reserve(capacity);
+}
+
+auto render_queue::begin(glm::mat4 const& view, glm::mat4 const& projection, glm::vec2 const& near_far) -> void {
+    m_frame = {view, projection, near_far};
+    m_stats = {};
+    m_commands.clear();
+    m_keys.clear();
+    m_order.clear();
+}
+
+auto render_queue::submit(uint8_t const& pass, blend const& blend, shader& program, uint32_t const& texture,
+                          mesh::primitive const& primitive, glm::mat4 const& model) -> void {
+    submit(make_command(pass, blend, program, texture, primitive, model, depth(glm::vec3(model[3]))));
+}
+
+auto render_queue::submit(uint8_t const& pass, blend const& blend, draw_fn const& draw, void const* user,
+                          float const& depth) -> void {
+    submit(make_command(pass, blend, draw, user, depth));
+}
+
+auto render_queue::submit(command_list const& list) -> void {
+    auto const& commands = list.commands();
+    m_commands.insert(std::end(m_commands), std::begin(commands), std::end(commands));
+}
+
+auto render_queue::make_command(uint8_t const& pass, blend const& blend, draw_fn const& draw, void const* user,
+                                float const& depth) -> command {
+    command cmd{};
+    cmd.draw = draw;
+    cmd.user = user;
+    cmd.key  = make_key(pass, blend, 0, 0, 0, depth);
+    return cmd;
+}
+
+auto render_queue::make_command(uint8_t const& pass, blend const& blend, shader& program, uint32_t const& texture,
+                                mesh::primitive const& primitive, glm::mat4 const& model, float const& depth) -> command {
+    command cmd{};
+    cmd.program = &program;
+    cmd.texture = texture;
+    cmd.vao     = primitive.get_array()->get_id();
+    cmd.mode    = primitive.get_surface()->topology() == mesh::topology::triangle_strip
+                  ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    cmd.count   = primitive.count();
+    cmd.model   = model;
+    cmd.key     = make_key(pass, blend, program.id(), texture, cmd.vao, depth);
+    return cmd;
+}
+
+auto render_queue::depth(glm::vec3 const& point) const -> float {
+    auto view = m_frame.view * glm::vec4(point, 1.0f);
+    return -view.z / m_frame.near_far.y;
+}
+
+auto render_queue::make_key(uint8_t const& pass, blend const& blend, uint32_t const& shader,
+                            uint32_t const& texture, uint32_t const& vao, float const& depth) -> uint64_t {
+    constexpr auto depth_max = uint64_t((1 << 24) - 1);
+    auto const d = uint64_t(std::clamp(depth, 0.0f, 1.0f) * float(depth_max));
+
+    auto key = uint64_t(pass & 0xF) << 60 | uint64_t(blend) << 59;
+    if (blend == blend::opaque) {
+        key |= uint64_t(shader  & 0x7FF) << 48;
+        key |= uint64_t(texture & 0xFFF) << 36;
+        key |= uint64_t(vao     & 0xFFF) << 24;
+        key |= d;
+    } else {
+        key |= (depth_max - d) << 35;
+        key |= uint64_t(shader  & 0x7FF) << 24;
+        key |= uint64_t(texture & 0xFFF) << 12;
+        key |= uint64_t(vao     & 0xFFF);
+    }
+    return key;
+}
+
+// LSD radix sort over the key bytes, passes where every key shares the same
+// byte are skipped. Stable, so equal keys keep their submission order.
+auto render_queue::sort() -> void {
+    LUMA_PROFILE_FUNCTION();
+    auto const count = m_commands.size();
+    m_keys.resize(count);
+    m_order.resize(count);
+    m_scratch_keys.resize(count);
+    m_scratch_order.resize(count);
+    for (usize i = 0; i < count; i++) m_keys[i] = m_commands[i].key;
+    std::iota(std::begin(m_order), std::end(m_order), 0);
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        std::array<usize, 256> histogram{};
+        for (auto const& key : m_keys) histogram[(key >> shift) & 0xFF]++;
+        if (histogram[(m_keys.empty() ? 0 : m_keys[0] >> shift) & 0xFF] == count) continue;
+
+        usize offset = 0;
+        for (auto& bucket : histogram) {
+            auto size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (usize i = 0; i < count; i++) {
+            auto& slot = histogram[(m_keys[i] >> shift) & 0xFF];
+            m_scratch_keys[slot]  = m_keys[i];
+            m_scratch_order[slot] = m_order[i];
+            slot++;
+        }
+        m_keys.swap(m_scratch_keys);
+        m_order.swap(m_scratch_order);
+    }
+}
+
+auto render_queue::execute() -> void {
+    execute(0, m_order.size());
+}
+
+auto render_queue::execute(uint8_t const& pass) -> void {
+    auto first = std::lower_bound(std::begin(m_keys), std::end(m_keys), uint64_t(pass) << 60);
+    auto last  = pass >= 0xF ? std::end(m_keys)
+                             : std::lower_bound(first, std::end(m_keys), uint64_t(pass + 1) << 60);
+    execute(usize(first - std::begin(m_keys)), usize(last - std::begin(m_keys)));
+}
+
+auto render_queue::execute(usize const& first, usize const& last) -> void {
+    LUMA_PROFILE_SCOPE("render_queue::execute");
+    constexpr auto none = max::u32;
+    shader*  program = nullptr;
+    uint32_t texture = none;
+    uint32_t vao     = none;
+    uint32_t blended = none;
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(mesh::restart_index);
+
+    for (auto i = first; i < last; i++) {
+        auto const& cmd = m_commands[m_order[i]];
+        m_stats.commands++;
+
+        auto const is_transparent = uint32_t(cmd.key >> 59) & 1;
+        if (is_transparent != blended) {
+            blended = is_transparent;
+            m_stats.blend_changes++;
+            if (is_transparent) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+            } else {
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+            }
+        }
+
+        if (cmd.draw) {
+            cmd.draw(cmd.user, m_frame);
+            // Unknown state afterwards, rebind everything on the next packet.
+            program = nullptr;
+            texture = vao = none;
+            continue;
+        }
+
+        if (cmd.program != program) {
+            program = cmd.program;
+            program->bind();
+            program->num("u_texture", 0);
+            program->mat4("u_view", glm::value_ptr(m_frame.view));
+            program->mat4("u_projection", glm::value_ptr(m_frame.projection));
+            m_stats.shader_changes++;
+        }
+        if (cmd.texture != texture) {
+            texture = cmd.texture;
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            m_stats.texture_changes++;
+        }
+        if (cmd.vao != vao) {
+            vao = cmd.vao;
+            glBindVertexArray(vao);
+            m_stats.vao_changes++;
+        }
+
+        program->mat4("u_model", glm::value_ptr(cmd.model));
+        for (auto u = cmd.uniforms; u; u = u->next)
+            program->uniform(u->name, u->type, u->data, u->count);
+        auto const offset = (void const*)(intptr_t)(cmd.first_index * sizeof(uint32_t));
+        if (cmd.instances > 1)
+            glDrawElementsInstancedBaseVertex(cmd.mode, cmd.count, GL_UNSIGNED_INT, offset, cmd.instances, cmd.base_vertex);
+        else
+            glDrawElementsBaseVertex(cmd.mode, cmd.count, GL_UNSIGNED_INT, offset, cmd.base_vertex);
+    }
+
+    // Left as they were found, the passes after the queue draw opaque.
+    if (blended == 1) glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_PRIMITIVE_RESTART);
+}
+
+}
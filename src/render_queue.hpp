@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "luma.hpp"
+#include "shader.hpp"
+#include "primitive.hpp"
+#include "glm/glm.hpp"
+
+namespace luma {
+
+class command_list;
+
+// Draws are recorded as small packets, sorted by a 64-bit key and replayed
+// with only the state changes between neighbouring packets.
+//
+// key layout, most significant bit first:
+//   opaque:      pass:4 | blend:1 | shader:11 | texture:12 | vao:12 | depth:24
+//   transparent: pass:4 | blend:1 | depth:24  | shader:11  | texture:12 | vao:12
+// Opaque packets are grouped by state and drawn front to back within a
+// group, transparent packets are drawn strictly back to front.
+class render_queue {
+  public:
+    enum class blend : uint8_t {
+        opaque      = 0,
+        transparent = 1,
+    };
+
+    struct frame {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec2 near_far;
+    };
+
+    // Custom draw for packets that don't fit an indexed draw, e.g. grid.
+    using draw_fn = void (*)(void const* user, frame const& frame);
+
+    // Extra uniform for a packet, uploaded after u_model. Name and data must
+    // stay alive until the queue has executed.
+    struct uniform {
+        char const*    name;
+        shader::type   type;
+        uint32_t       count;
+        void const*    data;
+        uniform const* next;
+    };
+
+    struct command {
+        uint64_t  key         = 0;
+        shader*   program     = nullptr;
+        uint32_t  texture     = 0;
+        uint32_t  vao         = 0;
+        uint32_t  mode        = GL_TRIANGLES;
+        uint32_t  count       = 0;
+        uint32_t  first_index = 0;
+        int32_t   base_vertex = 0;
+        uint32_t  instances   = 1;
+        glm::mat4 model{1.0f};
+        uniform const* uniforms = nullptr;
+        draw_fn     draw = nullptr;
+        void const* user = nullptr;
+    };
+
+    struct stats {
+        uint32_t commands;
+        uint32_t shader_changes;
+        uint32_t texture_changes;
+        uint32_t vao_changes;
+        uint32_t blend_changes;
+    };
+
+  public:
+    render_queue(usize const& capacity = 1024);
+    ~render_queue() = default;
+
+    // Clear the queue and set the camera used for depth keys and uniforms.
+    auto begin(glm::mat4 const& view, glm::mat4 const& projection, glm::vec2 const& near_far) -> void;
+
+    auto submit(command const& command) -> void { m_commands.push_back(command); }
+    auto submit(uint8_t const& pass, blend const& blend, shader& program, uint32_t const& texture,
+                mesh::primitive const& primitive, glm::mat4 const& model) -> void;
+    auto submit(uint8_t const& pass, blend const& blend, draw_fn const& draw, void const* user,
+                float const& depth = 1.0f) -> void;
+    // Merge packets recorded on another thread.
+    auto submit(command_list const& list) -> void;
+
+    static auto make_command(uint8_t const& pass, blend const& blend, shader& program, uint32_t const& texture,
+                             mesh::primitive const& primitive, glm::mat4 const& model, float const& depth) -> command;
+    static auto make_command(uint8_t const& pass, blend const& blend, draw_fn const& draw, void const* user,
+                             float const& depth = 1.0f) -> command;
+
+    auto sort() -> void;
+    auto execute() -> void;
+    auto execute(uint8_t const& pass) -> void;
+
+    auto size() const -> usize { return m_commands.size(); }
+    auto statistics() const -> stats const& { return m_stats; }
+
+    // View space distance of a point, normalised to [0, 1] by the far plane.
+    // Only reads the frame, safe to call while recording on worker threads.
+    auto depth(glm::vec3 const& point) const -> float;
+
+    static auto make_key(uint8_t const& pass, blend const& blend, uint32_t const& shader,
+                         uint32_t const& texture, uint32_t const& vao, float const& depth) -> uint64_t;
+    static constexpr auto pass_of(uint64_t const& key) -> uint8_t { return uint8_t(key >> 60); }
+
+  private:
+    auto execute(usize const& first, usize const& last) -> void;
+
+  private:
+    frame                 m_frame{};
+    stats                 m_stats{};
+    std::vector<command>  m_commands;
+    std::vector<uint64_t> m_keys;     // key, sorted with m_order
+    std::vector<uint32_t> m_order;    // command index per sorted key
+    std::vector<uint64_t> m_scratch_keys;
+    std::vector<uint32_t> m_scratch_order;
+};
+
+}
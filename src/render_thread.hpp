@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "luma.hpp"
+#include "window.hpp"
+#include "profile.hpp"
+
+namespace luma {
+
+// Single producer, single consumer hand over of the latest value. The writer
+// never waits for the reader and the reader always gets the newest complete
+// value, frames in between are dropped.
+template <typename T>
+class triple_buffer {
+  public:
+    triple_buffer() = default;
+    ~triple_buffer() = default;
+
+    auto write() -> T& { return m_slots[m_back]; }
+    auto publish() -> void {
+        m_back = m_middle.exchange(m_back | dirty) & index;
+    }
+
+    // Swap in the newest published value, returns false if nothing changed.
+    auto update() -> bool {
+        if (!(m_middle.load() & dirty)) return false;
+        m_front = m_middle.exchange(m_front) & index;
+        return true;
+    }
+    auto read() const -> T const& { return m_slots[m_front]; }
+
+  private:
+    static constexpr uint8_t index = 0x3;
+    static constexpr uint8_t dirty = 0x4;
+
+    std::array<T, 3>     m_slots{};
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t              m_back  = 0;
+    uint8_t              m_front = 2;
+};
+
+// Owns the GL context on its own thread and renders the latest snapshot
+// published by the main thread, which keeps polling events meanwhile.
+template <typename Snapshot>
+class render_thread {
+  public:
+    using render_fn = std::function<void(Snapshot const&)>;
+
+  public:
+    render_thread(window& window, render_fn const& render) : m_window(window), m_render(render) {}
+    ~render_thread() { stop(); }
+
+    auto publish(Snapshot const& snapshot) -> void {
+        m_frames.write() = snapshot;
+        {
+            std::lock_guard lock{m_mutex};
+            m_frames.publish();
+            m_is_pending = true;
+        }
+        m_condition.notify_one();
+    }
+
+    // Block until the render thread has taken the last published snapshot,
+    // which paces the producer to the frames actually rendered.
+    auto wait_taken() -> void {
+        std::unique_lock lock{m_mutex};
+        m_taken.wait(lock, [this] { return !m_is_pending || !m_is_running; });
+    }
+
+    // The calling thread gives up the context until stop().
+    auto start() -> void {
+        if (m_thread.joinable()) return;
+        m_is_running = true;
+        window::release_current();
+        m_thread = std::thread([this] { run(); });
+    }
+    auto stop() -> void {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard lock{m_mutex};
+            m_is_running = false;
+        }
+        m_condition.notify_one();
+        m_taken.notify_all();
+        m_thread.join();
+        m_window.make_current();
+    }
+
+  private:
+    auto run() -> void {
+        LUMA_PROFILE_THREAD("render");
+        m_window.make_current();
+        while (m_is_running) {
+            {
+                std::unique_lock lock{m_mutex};
+                m_condition.wait(lock, [this] { return !m_is_running || m_frames.update(); });
+                m_is_pending = false;
+            }
+            m_taken.notify_one();
+            if (!m_is_running) break;
+            m_render(m_frames.read());
+            LUMA_PROFILE_SCOPE("window::swap");
+            m_window.swap();
+        }
+        window::release_current();
+    }
+
+  private:
+    window&                 m_window;
+    render_fn               m_render;
+    triple_buffer<Snapshot> m_frames;
+    std::thread             m_thread;
+    std::atomic<bool>       m_is_running{false};
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_taken;
+    bool                    m_is_pending = false;
+};
+
+}
@@ -0,0 +1,416 @@
+#include "resample.hpp"
+#include "pixel.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+#include <immintrin.h>
+#define LUMA_RESAMPLE_AVX2
+#endif
+
+namespace luma::resample {
+
+// One RGBA pixel per 128-bit register. Multiply then add, never fused, so
+// every platform rounds the same way.
+#if defined(__SSE2__) || defined(_M_X64)
+struct f32x4 {
+    __m128 value;
+};
+static inline auto zero() -> f32x4 { return {_mm_setzero_ps()}; }
+static inline auto load(f32 const* p) -> f32x4 { return {_mm_loadu_ps(p)}; }
+static inline auto store(f32* p, f32x4 const& a) -> void { _mm_storeu_ps(p, a.value); }
+static inline auto madd(f32x4 const& acc, f32x4 const& a, f32 const& w) -> f32x4 {
+    return {_mm_add_ps(acc.value, _mm_mul_ps(a.value, _mm_set1_ps(w)))};
+}
+#elif defined(__ARM_NEON)
+struct f32x4 {
+    float32x4_t value;
+};
+static inline auto zero() -> f32x4 { return {vdupq_n_f32(0.0f)}; }
+static inline auto load(f32 const* p) -> f32x4 { return {vld1q_f32(p)}; }
+static inline auto store(f32* p, f32x4 const& a) -> void { vst1q_f32(p, a.value); }
+static inline auto madd(f32x4 const& acc, f32x4 const& a, f32 const& w) -> f32x4 {
+    return {vaddq_f32(acc.value, vmulq_n_f32(a.value, w))};
+}
+#else
+struct f32x4 {
+    f32 value[4];
+};
+static inline auto zero() -> f32x4 { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+static inline auto load(f32 const* p) -> f32x4 { return {{p[0], p[1], p[2], p[3]}}; }
+static inline auto store(f32* p, f32x4 const& a) -> void { std::copy_n(a.value, 4, p); }
+static inline auto madd(f32x4 const& acc, f32x4 const& a, f32 const& w) -> f32x4 {
+    return {{acc.value[0] + a.value[0] * w, acc.value[1] + a.value[1] * w,
+             acc.value[2] + a.value[2] * w, acc.value[3] + a.value[3] * w}};
+}
+#endif
+
+#ifdef LUMA_RESAMPLE_AVX2
+// Compiled per function like pixel's SSSE3 paths. AVX2 alone doesn't allow
+// FMA, products are rounded before the add exactly as above.
+static auto has_avx2() -> bool {
+    static bool const supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+static auto sinc(f64 x) -> f64 {
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+static auto bessel_i0(f64 const& x) -> f64 {
+    f64 sum = 1.0, term = 1.0;
+    for (int32_t k = 1; k < 32 && term > 1e-12 * sum; k++) {
+        auto const t = x / (2.0 * k);
+        term *= t * t;
+        sum  += term;
+    }
+    return sum;
+}
+
+static auto radius(filter const& kind) -> f64 {
+    switch (kind) {
+        case filter::box:      return 0.5;
+        case filter::kaiser:   return 2.0;
+        case filter::lanczos:  return 3.0;
+        case filter::mitchell: return 2.0;
+    }
+    return 0.5;
+}
+
+// `t` in output pixels.
+static auto evaluate(filter const& kind, f64 const& t) -> f64 {
+    switch (kind) {
+        case filter::box:
+            return t >= -0.5 && t < 0.5 ? 1.0 : 0.0;
+        case filter::kaiser: {
+            constexpr f64 alpha = 4.0;
+            auto const r = t / 2.0;
+            if (r <= -1.0 || r >= 1.0) return 0.0;
+            return sinc(t) * bessel_i0(alpha * std::sqrt(1.0 - r * r)) / bessel_i0(alpha);
+        }
+        case filter::lanczos:
+            return t > -3.0 && t < 3.0 ? sinc(t) * sinc(t / 3.0) : 0.0;
+        case filter::mitchell: {
+            constexpr f64 b = 1.0 / 3.0, c = 1.0 / 3.0;
+            auto const x = std::abs(t);
+            if (x < 1.0)
+                return ((12.0 - 9.0 * b - 6.0 * c) * x * x * x + (-18.0 + 12.0 * b + 6.0 * c) * x * x
+                        + (6.0 - 2.0 * b)) / 6.0;
+            if (x < 2.0)
+                return ((-b - 6.0 * c) * x * x * x + (6.0 * b + 30.0 * c) * x * x + (-12.0 * b - 48.0 * c) * x
+                        + (8.0 * b + 24.0 * c)) / 6.0;
+            return 0.0;
+        }
+    }
+    return 0.0;
+}
+
+// Per output index the contiguous run of source indices it reads and their
+// normalised weights, padded to `stride`. Taps past the border are folded
+// onto the edge pixel.
+struct taps {
+    std::vector<int32_t> first;
+    std::vector<int32_t> count;
+    std::vector<f32>     weights;
+    int32_t              stride = 0;
+};
+
+static auto make_taps(int32_t const& from, int32_t const& to, filter const& kind) -> taps {
+    auto const scale   = f64(from) / f64(to);
+    auto const stretch = std::max(scale, 1.0);
+    auto const support = radius(kind) * stretch;
+
+    taps result;
+    result.first.resize(usize(to));
+    result.count.resize(usize(to));
+    result.stride = int32_t(std::ceil(support * 2.0)) + 1;
+    result.weights.assign(usize(to) * usize(result.stride), 0.0f);
+
+    std::vector<f64> weights(usize(result.stride));
+    for (int32_t i = 0; i < to; i++) {
+        auto const center = (i + 0.5) * scale - 0.5;
+        auto const lo = int32_t(std::ceil(center - support));
+        auto const hi = int32_t(std::floor(center + support));
+        auto const first = std::clamp(lo, 0, from - 1);
+        auto const last  = std::clamp(hi, first, from - 1);
+
+        std::fill(std::begin(weights), std::end(weights), 0.0);
+        f64 total = 0.0;
+        for (int32_t j = lo; j <= hi; j++) {
+            auto const w = evaluate(kind, (j - center) / stretch);
+            weights[usize(std::clamp(j, first, last) - first)] += w;
+            total += w;
+        }
+        if (total == 0.0) {
+            weights[usize(std::clamp(int32_t(std::lround(center)), first, last) - first)] = 1.0;
+            total = 1.0;
+        }
+
+        result.first[usize(i)] = first;
+        result.count[usize(i)] = last - first + 1;
+        auto out = result.weights.data() + usize(i) * usize(result.stride);
+        for (int32_t k = 0; k <= last - first; k++) out[k] = f32(weights[usize(k)] / total);
+    }
+    return result;
+}
+
+#ifdef LUMA_RESAMPLE_AVX2
+// Two output pixels a step, one per 128-bit half, each with its own taps.
+// Both run to the longer of their counts on zero weights, which is why rows
+// are padded past their end.
+__attribute__((target("avx2")))
+static auto filter_row_avx2(f32 const* row, taps const& xs, int32_t const& to_width, f32* out) -> int32_t {
+    int32_t x = 0;
+    for (; x + 2 <= to_width; x += 2) {
+        auto const i = usize(x);
+        auto const wa = xs.weights.data() + i * usize(xs.stride);
+        auto const wb = wa + xs.stride;
+        auto const a  = row + usize(xs.first[i]) * 4;
+        auto const b  = row + usize(xs.first[i + 1]) * 4;
+        auto const count = std::max(xs.count[i], xs.count[i + 1]);
+        auto acc = _mm256_setzero_ps();
+        for (int32_t k = 0; k < count; k++) {
+            auto const v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a + k * 4)), _mm_loadu_ps(b + k * 4), 1);
+            auto const w = _mm256_insertf128_ps(_mm256_set1_ps(wa[k]), _mm_set1_ps(wb[k]), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(v, w));
+        }
+        _mm256_storeu_ps(out + i * 4, acc);
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static auto filter_column_avx2(f32 const* const* rows, f32 const* weights, int32_t const& count,
+                               f32* out, usize const& size) -> usize {
+    usize x = 0;
+    for (; x + 8 <= size; x += 8) {
+        auto acc = _mm256_setzero_ps();
+        for (int32_t k = 0; k < count; k++)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + x), _mm256_set1_ps(weights[k])));
+        _mm256_storeu_ps(out + x, acc);
+    }
+    return x;
+}
+#endif
+
+// One output row from one source row, padded with at least `xs.stride`
+// zero pixels.
+static auto filter_row(f32 const* row, taps const& xs, int32_t const& to_width, f32* out) -> void {
+    int32_t x = 0;
+#ifdef LUMA_RESAMPLE_AVX2
+    if (has_avx2()) x = filter_row_avx2(row, xs, to_width, out);
+#endif
+    for (; x < to_width; x++) {
+        auto const weights = xs.weights.data() + usize(x) * usize(xs.stride);
+        auto const source  = row + usize(xs.first[usize(x)]) * 4;
+        auto acc = zero();
+        for (int32_t k = 0; k < xs.count[usize(x)]; k++) acc = madd(acc, load(source + k * 4), weights[k]);
+        store(out + usize(x) * 4, acc);
+    }
+}
+
+// `size` floats of one output row from `count` filtered rows.
+static auto filter_column(f32 const* const* rows, f32 const* weights, int32_t const& count,
+                          f32* out, usize const& size) -> void {
+    usize x = 0;
+#ifdef LUMA_RESAMPLE_AVX2
+    if (has_avx2()) x = filter_column_avx2(rows, weights, count, out, size);
+#endif
+    for (; x < size; x += 4) {
+        auto acc = zero();
+        for (int32_t k = 0; k < count; k++) acc = madd(acc, load(rows[k] + x), weights[k]);
+        store(out + x, acc);
+    }
+}
+
+template <typename Fetch>
+static auto resize_rows(int32_t const& width, int32_t const& height, int32_t const& to_width,
+                        int32_t const& to_height, filter const& kind, Fetch const& fetch) -> surface {
+    auto const xs = make_taps(width, to_width, kind);
+    auto const ys = make_taps(height, to_height, kind);
+
+    surface result;
+    result.width  = to_width;
+    result.height = to_height;
+    result.pixels.resize(usize(to_width) * usize(to_height) * 4);
+    auto const stride = usize(to_width) * 4;
+
+    // Each band filters the source rows it needs horizontally, then
+    // vertically into its output rows. Neighbouring bands redo the few rows
+    // they share, cheaper than a second full size buffer.
+    thread_pool::shared().parallel_for(0, usize(to_height), [&](usize const& begin, usize const& end) {
+        auto const first = ys.first[begin];
+        auto const last  = ys.first[end - 1] + ys.count[end - 1];
+        std::vector<f32> row(usize(width + xs.stride) * 4, 0.0f);
+        std::vector<f32> band(usize(last - first) * stride);
+        std::vector<f32 const*> rows(usize(ys.stride));
+
+        for (auto y = first; y < last; y++) {
+            fetch(y, row.data());
+            filter_row(row.data(), xs, to_width, band.data() + usize(y - first) * stride);
+        }
+
+        for (auto y = begin; y < end; y++) {
+            for (int32_t k = 0; k < ys.count[y]; k++)
+                rows[usize(k)] = band.data() + usize(ys.first[y] - first + k) * stride;
+            filter_column(rows.data(), ys.weights.data() + y * usize(ys.stride), ys.count[y],
+                          result.pixels.data() + y * stride, stride);
+        }
+    }, 16);
+    return result;
+}
+
+auto fit(int32_t const& width, int32_t const& height, int32_t const& max_side) -> extent {
+    auto const side = std::max(width, height);
+    if (side <= max_side || side <= 0) return {width, height};
+    auto const scale = f64(max_side) / f64(side);
+    return {std::clamp(int32_t(std::lround(width * scale)), 1, max_side),
+            std::clamp(int32_t(std::lround(height * scale)), 1, max_side)};
+}
+
+auto resize(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels,
+            int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface {
+    LUMA_PROFILE_FUNCTION();
+    auto const stride = usize(width) * usize(channels);
+    return resize_rows(width, height, to_width, to_height, kind, [&](int32_t const& y, f32* row) {
+        // Per fetching thread, rows of one call share the width.
+        thread_local std::vector<u8> rgba;
+        rgba.resize(usize(width) * 4);
+        pixel::expand_rgba(pixels + usize(y) * stride, channels, rgba.data(), usize(width));
+        pixel::srgb_to_linear(rgba.data(), row, rgba.size());
+        for (usize x = 0; x < usize(width); x++, row += 4) {
+            // Alpha is linear already.
+            auto const a = f32(rgba[x * 4 + 3]) / 255.0f;
+            row[0] *= a;
+            row[1] *= a;
+            row[2] *= a;
+            row[3]  = a;
+        }
+    });
+}
+
+auto resize(void const* pixels, pixel::type const& type, int32_t const& width, int32_t const& height,
+            int32_t const& channels, int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface {
+    if (type == pixel::type::u8)
+        return resize(static_cast<u8 const*>(pixels), width, height, channels, to_width, to_height, kind);
+    LUMA_PROFILE_FUNCTION();
+    auto const stride = usize(width) * usize(channels);
+    return resize_rows(width, height, to_width, to_height, kind, [&](int32_t const& y, f32* row) {
+        thread_local std::vector<f32> samples;
+        samples.resize(stride);
+        auto const offset = usize(y) * stride;
+        if (type == pixel::type::u16) {
+            auto const source = static_cast<u16 const*>(pixels) + offset;
+            pixel::srgb16_to_linear(source, samples.data(), stride);
+            // Alpha is linear already.
+            if (channels == 2 || channels == 4)
+                for (usize x = usize(channels) - 1; x < stride; x += usize(channels))
+                    samples[x] = f32(source[x]) / 65535.0f;
+        } else if (type == pixel::type::f16) {
+            pixel::from_half(static_cast<u16 const*>(pixels) + offset, samples.data(), stride);
+        } else {
+            std::copy_n(static_cast<f32 const*>(pixels) + offset, stride, samples.data());
+        }
+        for (usize x = 0; x < usize(width); x++, row += 4) {
+            auto const in = samples.data() + x * usize(channels);
+            auto const a  = channels == 2 || channels == 4 ? std::clamp(in[channels - 1], 0.0f, 1.0f) : 1.0f;
+            auto const r  = in[0];
+            auto const g  = channels >= 3 ? in[1] : r;
+            auto const b  = channels >= 3 ? in[2] : r;
+            row[0] = r * a;
+            row[1] = g * a;
+            row[2] = b * a;
+            row[3] = a;
+        }
+    });
+}
+
+auto resize(surface const& source, int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface {
+    LUMA_PROFILE_FUNCTION();
+    auto const stride = usize(source.width) * 4;
+    return resize_rows(source.width, source.height, to_width, to_height, kind, [&](int32_t const& y, f32* row) {
+        std::copy_n(source.pixels.data() + usize(y) * stride, stride, row);
+    });
+}
+
+auto encode(surface const& source, int32_t const& channels, u8* pixels) -> void {
+    LUMA_PROFILE_FUNCTION();
+    auto const width = usize(source.width);
+    thread_pool::shared().parallel_for(0, usize(source.height), [&](usize const& begin, usize const& end) {
+        std::vector<f32> color(width * 4);
+        std::vector<u8>  encoded(width * 4);
+        for (auto y = begin; y < end; y++) {
+            auto const in = source.pixels.data() + y * width * 4;
+            for (usize x = 0; x < width * 4; x += 4) {
+                auto const a = std::clamp(in[x + 3], 0.0f, 1.0f);
+                auto const unpremultiply = a > 0.0f ? 1.0f / a : 0.0f;
+                color[x + 0] = in[x + 0] * unpremultiply;
+                color[x + 1] = in[x + 1] * unpremultiply;
+                color[x + 2] = in[x + 2] * unpremultiply;
+                color[x + 3] = 0.0f;
+            }
+            pixel::linear_to_srgb(color.data(), encoded.data(), color.size());
+
+            auto out = pixels + y * width * usize(channels);
+            for (usize x = 0; x < width; x++, out += channels) {
+                out[0] = encoded[x * 4];
+                if (channels >= 3) {
+                    out[1] = encoded[x * 4 + 1];
+                    out[2] = encoded[x * 4 + 2];
+                }
+                if (channels == 2 || channels == 4)
+                    out[channels - 1] = u8(std::lround(std::clamp(in[x * 4 + 3], 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    }, 32);
+}
+
+auto encode(surface const& source, int32_t const& channels, pixel::type const& type, void* pixels) -> void {
+    if (type == pixel::type::u8) return encode(source, channels, static_cast<u8*>(pixels));
+    LUMA_PROFILE_FUNCTION();
+    auto const width  = usize(source.width);
+    auto const stride = width * usize(channels);
+    thread_pool::shared().parallel_for(0, usize(source.height), [&](usize const& begin, usize const& end) {
+        std::vector<f32> samples(stride);
+        for (auto y = begin; y < end; y++) {
+            auto const in = source.pixels.data() + y * width * 4;
+            for (usize x = 0; x < width; x++) {
+                auto const a = std::clamp(in[x * 4 + 3], 0.0f, 1.0f);
+                auto const unpremultiply = a > 0.0f ? 1.0f / a : 0.0f;
+                auto out = samples.data() + x * usize(channels);
+                out[0] = in[x * 4] * unpremultiply;
+                if (channels >= 3) {
+                    out[1] = in[x * 4 + 1] * unpremultiply;
+                    out[2] = in[x * 4 + 2] * unpremultiply;
+                }
+                if (channels == 2 || channels == 4) out[channels - 1] = a;
+            }
+
+            auto const offset = y * stride;
+            if (type == pixel::type::u16) {
+                auto const out = static_cast<u16*>(pixels) + offset;
+                pixel::linear_to_srgb16(samples.data(), out, stride);
+                if (channels == 2 || channels == 4)
+                    for (usize x = usize(channels) - 1; x < stride; x += usize(channels))
+                        out[x] = u16(std::lround(samples[x] * 65535.0f));
+            } else if (type == pixel::type::f16) {
+                pixel::to_half(samples.data(), static_cast<u16*>(pixels) + offset, stride);
+            } else {
+                std::copy_n(samples.data(), stride, static_cast<f32*>(pixels) + offset);
+            }
+        }
+    }, 32);
+}
+
+}
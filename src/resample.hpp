@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "luma.hpp"
+#include "pixel.hpp"
+
+namespace luma::resample {
+
+enum class filter : uint8_t {
+    box,        // 2x2 average on exact halvings, cheapest and softest
+    kaiser,     // Kaiser windowed sinc, radius 2, sharp with little ringing
+    lanczos,    // Lanczos 3, sharpest, rings on hard edges
+    mitchell,   // Mitchell-Netravali B = C = 1/3, radius 2, soft with almost no ringing
+};
+
+// Linear light RGBA with premultiplied alpha, 4 floats per pixel whatever
+// the channel count of the source, rows bottom first like luma::image.
+struct surface {
+    std::vector<f32> pixels;
+    int32_t width  = 0;
+    int32_t height = 0;
+};
+
+struct extent {
+    int32_t width  = 0;
+    int32_t height = 0;
+};
+
+// The size with the same aspect whose longer side is `max_side`, or the size
+// itself when it already fits.
+auto fit(int32_t const& width, int32_t const& height, int32_t const& max_side) -> extent;
+
+// Separable resize to any size in linear light, weights are tabulated once
+// per axis. Output rows are split into bands across the shared thread_pool,
+// each output pixel is summed by one thread in a fixed order so the result
+// doesn't depend on the number of workers, nor on whether the CPU has AVX2.
+//
+// sRGB encoded 8-bit source with 1 to 4 channels, decoded a row at a time.
+auto resize(u8 const* pixels, int32_t const& width, int32_t const& height, int32_t const& channels,
+            int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface;
+// Any pixel::type, `pixels` pointing at samples of that type.
+auto resize(void const* pixels, pixel::type const& type, int32_t const& width, int32_t const& height,
+            int32_t const& channels, int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface;
+auto resize(surface const& source, int32_t const& to_width, int32_t const& to_height, filter const& kind) -> surface;
+
+// Back to sRGB 8-bit with `channels` channels, rounded to the nearest code.
+auto encode(surface const& source, int32_t const& channels, u8* pixels) -> void;
+// To any pixel::type, floats keep values past 1.
+auto encode(surface const& source, int32_t const& channels, pixel::type const& type, void* pixels) -> void;
+
+}
@@ -0,0 +1,213 @@
+#include "sequence.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace luma {
+
+static auto image_bytes(image const& image) -> usize {
+    auto bytes = image.bytes();
+    for (auto const& mip : image.mips()) bytes += image_bytes(*mip);
+    return bytes;
+}
+
+// What stb_image decodes.
+static auto is_image(std::filesystem::path const& path) -> bool {
+    auto extension = path.extension().string();
+    std::transform(std::begin(extension), std::end(extension), std::begin(extension),
+                   [](unsigned char c) { return char(std::tolower(c)); });
+    for (auto known : {".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm"})
+        if (extension == known) return true;
+    return false;
+}
+
+sequence::sequence(std::vector<std::string> const& files, options const& settings)
+    : m_files(files), m_options(settings), m_max_side(texture::upload_limit()),
+      m_max_in_flight(std::max<usize>(thread_pool::shared().size() / 2, 1)) {}
+
+sequence::sequence(std::vector<std::string> const& files) : sequence(files, options{}) {}
+
+sequence::~sequence() {
+    for (auto& [index, slot] : m_slots) *slot.cancelled = true;
+    std::unique_lock lock{m_mutex};
+    m_condition.wait(lock, [this] { return m_pending == 0; });
+}
+
+auto sequence::filename() const -> std::string const& {
+    static std::string const none{};
+    return m_files.empty() ? none : m_files[m_index];
+}
+
+auto sequence::seek(usize const& index) -> void {
+    if (m_files.empty()) return;
+    auto const target = std::min(index, m_files.size() - 1);
+    if (target == m_index) return;
+    m_direction = target > m_index ? 1 : -1;
+    m_index     = target;
+}
+
+auto sequence::update() -> void {
+    LUMA_PROFILE_SCOPE("sequence::update");
+    if (m_files.empty()) return;
+    collect();
+
+    // The window around the cursor, cut where the budget runs out. The
+    // cursor itself is kept whatever it costs.
+    auto const order = wanted();
+    std::vector<usize> keep;
+    usize held = 0;
+    for (auto const index : order) {
+        if (!keep.empty() && held >= m_options.budget) break;
+        keep.push_back(index);
+        if (auto it = m_slots.find(index); it != std::end(m_slots)) held += it->second.bytes;
+        else held += m_estimate;
+    }
+
+    std::vector<usize> obsolete;
+    for (auto const& [index, slot] : m_slots)
+        if (std::find(std::begin(keep), std::end(keep), index) == std::end(keep)) obsolete.push_back(index);
+    for (auto const index : obsolete) drop(index);
+
+    // Nearest first, so the cursor is uploaded as soon as it is decoded.
+    for (auto const index : keep) {
+        auto it = m_slots.find(index);
+        if (it == std::end(m_slots) || !it->second.decoded) continue;
+        auto& slot = it->second;
+        slot.uploaded = make_ref<luma::texture>(m_files[index], slot.decoded, m_options.mipmap);
+        slot.decoded  = nullptr;
+        slot.bytes    = slot.uploaded->gpu_bytes();
+        m_stats.uploads++;
+        break;
+    }
+
+    if (auto it = m_slots.find(m_index); it != std::end(m_slots) && it->second.uploaded)
+        m_shown = it->second.uploaded;
+
+    // The cursor goes past the limit, running decodes may all be obsolete.
+    for (auto const index : keep) {
+        if (m_slots.find(index) != std::end(m_slots)) continue;
+        if (index != m_index && m_in_flight >= m_max_in_flight) break;
+        schedule(index);
+    }
+}
+
+auto sequence::is_current_ready() const -> bool {
+    auto it = m_slots.find(m_index);
+    return it != std::end(m_slots) && it->second.uploaded && it->second.uploaded == m_shown;
+}
+
+auto sequence::is_current_failed() const -> bool {
+    auto it = m_slots.find(m_index);
+    return it != std::end(m_slots) && it->second.failed;
+}
+
+auto sequence::statistics() const -> stats {
+    auto result = m_stats;
+    result.slots = m_slots.size();
+    result.held_bytes = 0;
+    for (auto const& [index, slot] : m_slots) result.held_bytes += slot.bytes;
+    return result;
+}
+
+auto sequence::scan(std::filesystem::path const& directory) -> std::vector<std::string> {
+    std::vector<std::string> result;
+    std::error_code error;
+    for (auto const& entry : std::filesystem::directory_iterator{directory, error})
+        if (entry.is_regular_file(error) && is_image(entry.path())) result.push_back(entry.path().string());
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+auto sequence::expand(std::vector<std::string> const& paths) -> std::vector<std::string> {
+    std::vector<std::string> result;
+    for (auto const& path : paths) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error)) {
+            result.push_back(path);
+            continue;
+        }
+        auto const files = scan(path);
+        result.insert(std::end(result), std::begin(files), std::end(files));
+    }
+    return result;
+}
+
+auto sequence::wanted() const -> std::vector<usize> {
+    // The side being stepped towards gets `ahead`, the other `behind`, both
+    // interleaved by distance.
+    auto const forward  = m_direction > 0 ? m_options.ahead : m_options.behind;
+    auto const backward = m_direction > 0 ? m_options.behind : m_options.ahead;
+    std::vector<usize> result{m_index};
+    auto add = [&](isize const& index) {
+        if (index >= 0 && usize(index) < m_files.size()) result.push_back(usize(index));
+    };
+    for (usize distance = 1; distance <= std::max(forward, backward); distance++) {
+        if (distance <= forward)  add(isize(m_index) + isize(distance) * m_direction);
+        if (distance <= backward) add(isize(m_index) - isize(distance) * m_direction);
+    }
+    return result;
+}
+
+auto sequence::collect() -> void {
+    std::vector<result> results;
+    {
+        std::lock_guard lock{m_mutex};
+        results.swap(m_results);
+    }
+    for (auto& done : results) {
+        m_in_flight--;
+        // Dropped meanwhile, and maybe scheduled again since.
+        auto it = m_slots.find(done.index);
+        if (it == std::end(m_slots) || it->second.cancelled != done.cancelled || !done.decoded) continue;
+
+        if (!done.decoded->buffer()) {
+            // Nothing to upload, and its size says nothing about the others.
+            std::cerr << "ERROR::SEQUENCE: Failed to load " << m_files[done.index] << '\n';
+            it->second.failed = true;
+            it->second.bytes  = 0;
+            m_stats.failed++;
+            continue;
+        }
+        it->second.decoded = done.decoded;
+        it->second.bytes   = image_bytes(*done.decoded);
+        m_estimate = it->second.bytes;
+        m_stats.decodes++;
+        if (m_on_decoded) m_on_decoded(done.index, *done.decoded);
+    }
+}
+
+auto sequence::schedule(usize const& index) -> void {
+    auto cancelled = make_ref<std::atomic<bool>>(false);
+    m_slots[index] = {cancelled, nullptr, nullptr, m_estimate, false};
+    m_in_flight++;
+    {
+        std::lock_guard lock{m_mutex};
+        m_pending++;
+    }
+    thread_pool::shared().submit([this, index, cancelled, filename = m_files[index],
+                                  mipmap = m_options.mipmap, max_side = m_max_side] {
+        ref<image> decoded;
+        if (!*cancelled) {
+            LUMA_PROFILE_SCOPE("sequence::decode");
+            decoded = texture::decode(filename, mipmap, max_side);
+        }
+        std::lock_guard lock{m_mutex};
+        m_results.push_back({index, cancelled, decoded});
+        m_pending--;
+        m_condition.notify_all();
+    });
+}
+
+auto sequence::drop(usize const& index) -> void {
+    auto it = m_slots.find(index);
+    if (!it->second.decoded && !it->second.uploaded && !it->second.failed) {
+        *it->second.cancelled = true;
+        m_stats.cancelled++;
+    }
+    m_slots.erase(it);
+}
+
+}
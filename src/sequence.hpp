@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "luma.hpp"
+#include "texture.hpp"
+
+namespace luma {
+
+// Steps through a list of images with the neighbours of the current one
+// decoded ahead on the shared thread_pool. Images nearest the cursor come
+// first, further in the direction of travel than behind it, until `budget`
+// bytes of decoded and uploaded images are held. Moving the cursor cancels
+// decodes that fell out of that window, queued ones are skipped and running
+// ones are thrown away when they finish.
+//
+// At most one image is uploaded per update(), and current() keeps returning
+// the last uploaded texture until the new one is ready, so stepping never
+// stalls a frame. Everything but the decoding happens on the GL thread.
+class sequence {
+  public:
+    struct options {
+        usize ahead  = 8;
+        usize behind = 2;
+        usize budget = usize(1) << 30;
+        bool  mipmap = true;
+    };
+
+    struct stats {
+        u64   decodes;
+        u64   uploads;
+        u64   cancelled;    // dropped before or while decoding
+        u64   failed;       // files that could not be decoded
+        usize held_bytes;
+        usize slots;
+    };
+
+    using decoded_fn = std::function<void(usize const& index, image const& decoded)>;
+
+  public:
+    sequence(std::vector<std::string> const& files, options const& settings);
+    explicit sequence(std::vector<std::string> const& files);
+    ~sequence();
+    sequence(sequence const&) = delete;
+    auto operator=(sequence const&) -> sequence& = delete;
+
+    auto size() const -> usize { return m_files.size(); }
+    auto index() const -> usize { return m_index; }
+    auto filename() const -> std::string const&;
+
+    // Clamped to the list.
+    auto seek(usize const& index) -> void;
+    auto next() -> void { seek(m_index + 1); }
+    auto previous() -> void { seek(m_index > 0 ? m_index - 1 : 0); }
+
+    // Once a frame on the GL thread: collects finished decodes, uploads at
+    // most one and schedules more.
+    auto update() -> void;
+    // Null until the first image is uploaded.
+    auto current() const -> ref<texture> { return m_shown; }
+    auto is_current_ready() const -> bool;
+    // The current file could not be decoded, current() stays on the last image.
+    auto is_current_failed() const -> bool;
+
+    auto statistics() const -> stats;
+    // Called from update() with every image as it is decoded, before it is
+    // uploaded and its pixels are let go, e.g. to take a thumbnail.
+    auto on_decoded(decoded_fn const& fn) -> void { m_on_decoded = fn; }
+
+    // Image files in `directory`, sorted by name. expand() replaces the
+    // directories in a list of paths by their scan.
+    static auto scan(std::filesystem::path const& directory) -> std::vector<std::string>;
+    static auto expand(std::vector<std::string> const& paths) -> std::vector<std::string>;
+
+  private:
+    struct slot {
+        ref<std::atomic<bool>> cancelled;
+        ref<image>             decoded;
+        ref<luma::texture>     uploaded;
+        usize                  bytes  = 0;
+        bool                   failed = false;  // kept so the file isn't decoded again
+    };
+
+    struct result {
+        usize                  index;
+        ref<std::atomic<bool>> cancelled;
+        ref<image>             decoded;
+    };
+
+    auto wanted() const -> std::vector<usize>;
+    auto collect() -> void;
+    auto schedule(usize const& index) -> void;
+    auto drop(usize const& index) -> void;
+
+  private:
+    std::vector<std::string> m_files;
+    options  m_options;
+    int32_t  m_max_side;
+    usize    m_index     = 0;
+    int32_t  m_direction = 1;
+    usize    m_in_flight = 0;
+    usize    m_max_in_flight;
+    usize    m_estimate  = 0;   // bytes of the last decode, stands in for those still running
+
+    std::unordered_map<usize, slot> m_slots;
+    ref<luma::texture> m_shown;
+    stats m_stats{};
+    decoded_fn m_on_decoded;
+
+    // Finished decodes, handed over from the workers.
+    std::mutex              m_mutex;
+    std::condition_variable m_condition;
+    std::vector<result>     m_results;
+    usize                   m_pending = 0;
+};
+
+}
@@ -1,4 +1,5 @@
 #include "shader.hpp"
+#include "profile.hpp"
 
 namespace luma {
 auto shader::create(std::string const& vertex, std::string const& fragment) -> ref<shader> {
@@ -6,6 +7,7 @@ auto shader::create(std::string const& vertex, std::string const& fragment) -> r
 }
 
 shader::shader(std::string const& vertex, std::string const& fragment) {
+    LUMA_PROFILE_SCOPE("shader::build");
     auto vs = compile(GL_VERTEX_SHADER,   vertex.c_str());
     auto fs = compile(GL_FRAGMENT_SHADER, fragment.c_str());
     m_id = link(vs, fs);
@@ -48,7 +50,34 @@ auto shader::mat4(std::string const& name, float const* m4,
     glUniformMatrix4fv(uniform_location(name), count, (transpose ? GL_TRUE : GL_FALSE), m4);
 }
 
+auto shader::uniform(std::string const& name, type const& type, void const* data, uint32_t const& count) -> void {
+    bind();
+    auto location = int32_t(uniform_location(name));
+    auto f = static_cast<float const*>(data);
+    auto i = static_cast<int32_t const*>(data);
+    auto u = static_cast<uint32_t const*>(data);
+    switch (type) {
+        case type::boolean:
+        case type::i32:   glUniform1iv(location, count, i); break;
+        case type::u32:   glUniform1uiv(location, count, u); break;
+        case type::f32:   glUniform1fv(location, count, f); break;
+        case type::vec2:  glUniform2fv(location, count, f); break;
+        case type::vec3:  glUniform3fv(location, count, f); break;
+        case type::vec4:  glUniform4fv(location, count, f); break;
+        case type::ivec2: glUniform2iv(location, count, i); break;
+        case type::ivec3: glUniform3iv(location, count, i); break;
+        case type::ivec4: glUniform4iv(location, count, i); break;
+        case type::mat2:  glUniformMatrix2fv(location, count, GL_FALSE, f); break;
+        case type::mat3:  glUniformMatrix3fv(location, count, GL_FALSE, f); break;
+        case type::mat4:  glUniformMatrix4fv(location, count, GL_FALSE, f); break;
+        default:
+            std::cerr << "ERROR::SHADER::UNIFORM: unsupported type for " << name << '\n';
+            break;
+    }
+}
+
 auto shader::compile(uint32_t type, char const* source) -> uint32_t {
+    LUMA_PROFILE_FUNCTION();
     uint32_t shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, nullptr);
     glCompileShader(shader);
@@ -66,6 +95,7 @@ auto shader::compile(uint32_t type, char const* source) -> uint32_t {
 }
 
 auto shader::link(uint32_t const& vs, uint32_t const& fs) -> uint32_t {
+    LUMA_PROFILE_FUNCTION();
     uint32_t program = glCreateProgram();
     glAttachShader(program, vs);
     glAttachShader(program, fs);
@@ -88,6 +118,10 @@ auto shader::link(uint32_t const& vs, uint32_t const& fs) -> uint32_t {
 }
 
 auto shader::uniform_location(std::string const& name) -> uint32_t {
-    return glGetUniformLocation(m_id, name.c_str());
+    auto it = m_locations.find(name);
+    if (it != m_locations.end()) return it->second;
+    auto location = glGetUniformLocation(m_id, name.c_str());
+    m_locations.insert({name, location});
+    return location;
 }
 }
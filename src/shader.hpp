@@ -2,6 +2,7 @@
 #include <string>
 #include <cstdint>
 #include <iostream>
+#include <unordered_map>
 
 #include "luma.hpp"
 #include "glad/glad.h"
@@ -36,6 +37,7 @@ class shader {
     ~shader();
 
     auto bind() -> void;
+    auto id() const -> uint32_t { return m_id; }
 
     static auto create(std::string const& vertex, std::string const& fragment) -> ref<shader>;
 
@@ -51,6 +53,9 @@ class shader {
     auto mat4(std::string const& name, float const* m4,
                     uint32_t const& count = 1, bool const& transpose = false) -> void;
 
+    // Upload count values of the given type from a raw payload.
+    auto uniform(std::string const& name, type const& type, void const* data, uint32_t const& count = 1) -> void;
+
   private:
     auto compile(uint32_t type, char const* source) -> uint32_t;
     auto link(uint32_t const& vs, uint32_t const& fs) -> uint32_t;
@@ -59,6 +64,7 @@ class shader {
 
   private:
     uint32_t m_id;
+    std::unordered_map<std::string, int32_t> m_locations;
 };
 
 }
@@ -1,14 +1,136 @@
 #include "texture.hpp"
+#include "image_cache.hpp"
 #include "glad/glad.h"
+#include "profile.hpp"
+#include "resample.hpp"
+#include "thread_pool.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <vector>
 
 namespace luma {
-texture::texture(std::string const& filename, bool const& mipmap) {
-    m_image = make_ref<image>(filename);
+
+static std::atomic<int32_t> size_limit{0};
+
+static auto held_bytes(image const& image, bool const& is_mapped) -> usize {
+    auto bytes = image.buffer() && image.is_mapped() == is_mapped ? image.bytes() : 0;
+    for (auto const& mip : image.mips()) bytes += held_bytes(*mip, is_mapped);
+    return bytes;
+}
+
+static auto copy_of(image const& source) -> ref<image> {
+    auto copy = make_ref<image>(source.width(), source.height(), source.channels(), source.type());
+    std::memcpy(copy->buffer(), source.buffer(), source.bytes());
+    return copy;
+}
+
+// Copied from the first level that fits, so a mapped source is let go and
+// the mips with it, otherwise filtered down from the base.
+static auto make_proxy(image const& full) -> ref<image> {
+    if (std::max(full.width(), full.height()) <= texture::PROXY_SIZE) return copy_of(full);
+    for (auto const& mip : full.mips())
+        if (std::max(mip->width(), mip->height()) <= texture::PROXY_SIZE) return copy_of(*mip);
+    return full.thumbnail(texture::PROXY_SIZE);
+}
+
+// Filtered from the smallest level still covering `size`, a photo with mips
+// is never read in full to be shrunk.
+static auto shrink(image const& full, resample::extent const& size, bool const& mipmap) -> ref<image> {
+    auto source = &full;
+    for (auto const& mip : full.mips()) {
+        if (mip->width() < size.width || mip->height() < size.height) break;
+        source = mip.get();
+    }
+    auto result = source->resized(size.width, size.height);
+    if (mipmap) result->build_mips();
+    return result;
+}
+
+// f32 is converted a level at a time, halves keep the range at half the
+// memory and the GPU filters them at full rate.
+static auto pixels_of(image const& level, std::vector<u16>& staging) -> void const* {
+    if (level.type() != pixel::type::f32 || !level.buffer()) return level.buffer();
+    staging.resize(usize(level.width()) * usize(level.height()) * usize(std::clamp(level.channels(), 1, 4)));
+    pixel::to_half(reinterpret_cast<f32 const*>(level.buffer()), staging.data(), staging.size());
+    return staging.data();
+}
+
+// The base as the cache holds it, with its mips, when it fits. Otherwise the
+// file decoded or the entry filtered down, mips left to the caller.
+static auto load_base(std::string const& filename, int32_t const& max_side, bool& is_decoded) -> ref<image> {
+    auto result = image_cache::shared().load(filename, true);
+    is_decoded = !result;
+    if (is_decoded) result = make_ref<image>(filename);
+    auto const size = resample::fit(result->width(), result->height(), max_side);
+    if (result->buffer() && (size.width != result->width() || size.height != result->height())) {
+        result = shrink(*result, size, false);
+        is_decoded = false;
+    }
+    return result;
+}
+
+auto texture::upload_limit() -> int32_t {
+    GLint limit = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &limit);
+    if (limit <= 0) limit = std::numeric_limits<int32_t>::max();
+    auto const max = size_limit.load();
+    return max > 0 ? std::min(max, limit) : limit;
+}
+
+texture::texture(std::string const& filename, bool const& mipmap, bool const& compress, residency const& policy)
+    : m_filename(filename), m_is_mipmapped(mipmap), m_residency(policy) {
+    LUMA_PROFILE_SCOPE("texture::load");
+    if (filename.ends_with(".ktx")) {
+        auto surface = bc::load(filename);
+        if (surface && !bc::is_supported()) {
+            std::cerr << "ERROR::TEXTURE: S3TC is not supported, cannot upload " << filename << '\n';
+            surface = nullptr;
+        }
+        if (surface) {
+            // Pre-encoded mips are all or nothing, drop them if unwanted.
+            if (!mipmap) surface->levels.resize(1);
+            m_id = create_texture(*surface);
+        } else {
+            glGenTextures(1, &m_id);
+        }
+        return;
+    }
+
+    m_source = image_cache::inspect(filename);
+    // Encoding wants every level at once, otherwise only the base is made
+    // here and the mips are filtered on the thread_pool, see update().
+    if (!mipmap || (compress && bc::is_supported())) {
+        m_image = decode(filename, mipmap, upload_limit());
+        if (compress && m_image->buffer() && !pixel::is_float(m_image->type()) && bc::is_supported())
+            m_id = create_texture(bc::encode(*m_image, bc::choose(m_image->is_opaque())));
+        else
+            m_id = create_texture();
+        apply_residency();
+        return;
+    }
+
+    auto is_decoded = false;
+    m_image = load_base(filename, upload_limit(), is_decoded);
     m_id = create_texture();
-    glBindTexture(GL_TEXTURE_2D, m_id);
-    if (mipmap) generate_mipmap();
+    if (m_image->buffer() && m_image->mips().empty() && (m_image->width() > 1 || m_image->height() > 1)) {
+        // Written to the cache once complete, unless filtered down from the file.
+        m_is_cacheable = is_decoded;
+        m_pending = thread_pool::shared().submit([base = m_image] { return base->make_mips(); });
+        return;
+    }
+    apply_residency();
+}
+texture::texture(std::string const& filename, ref<image> const& decoded, bool const& mipmap, residency const& policy)
+    : m_image(decoded), m_filename(filename), m_source(image_cache::inspect(filename)), m_is_mipmapped(mipmap),
+      m_residency(policy) {
+    LUMA_PROFILE_SCOPE("texture::upload");
+    m_id = create_texture();
+    apply_residency();
 }
 texture::texture(int32_t const& width, int32_t const& height, int32_t const& channels) {
     m_image = make_ref<image>(width, height, channels);
@@ -24,10 +146,120 @@ auto texture::framebuffer(ref<buffer::frame> const& framebuffer) -> void {
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_id, 0);
 }
 auto texture::resize(int32_t const& width, int32_t const& height) -> void {
-    if (!(width != m_image->width() || height != m_image->height())) return;
-    m_image = make_ref<image>(width, height, m_image->channels());
+    if (m_image && width == m_image->width() && height == m_image->height()) return;
+    // The mips of the old size are of no use.
+    m_pending = {};
+    m_is_cacheable = false;
+    // Resized in place when nobody else holds the image, which keeps its
+    // buffer if the size class didn't change.
+    if (m_image && m_image.use_count() == 1) m_image->resize(width, height);
+    else m_image = make_ref<image>(width, height, m_image ? m_image->channels() : m_channels, m_type);
     glDeleteTextures(1, &m_id);
     m_id = create_texture();
+    apply_residency();
+}
+
+auto texture::read_image() const -> ref<image> {
+    if (!is_loaded()) return nullptr;
+    if (m_residency == residency::keep && m_image) return m_image;
+    // A file changed since the upload no longer matches, read the GPU copy.
+    // Only the base is wanted, a cache miss decodes without building mips
+    // or writing an entry.
+    if (!m_filename.empty() && !m_filename.ends_with(".ktx") && m_source
+        && image_cache::inspect(m_filename) == m_source) {
+        auto reread = image_cache::shared().load(m_filename, false);
+        if (!reread) reread = make_ref<image>(m_filename);
+        if (reread->buffer() && reread->width() == m_width && reread->height() == m_height) return reread;
+        // Shrunk on load, shrunk again the same way.
+        auto const size = resample::fit(reread->width(), reread->height(), std::max(m_width, m_height));
+        if (reread->buffer() && size.width == m_width && size.height == m_height)
+            return shrink(*reread, size, false);
+    }
+    return download();
+}
+
+auto texture::update() -> bool {
+    if (!m_pending.valid() || m_pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    LUMA_PROFILE_SCOPE("texture::update");
+    auto mips = m_pending.get();
+    std::vector<u16> staging;
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (usize i = 0; i < mips.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, GLint(i + 1), m_internal, mips[i]->width(), mips[i]->height(), 0, m_format,
+                     m_data_type, pixels_of(*mips[i], staging));
+        m_gpu_bytes += usize(mips[i]->width()) * usize(mips[i]->height()) * m_texel;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(mips.size()));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mips.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_image->set_mips(std::move(mips));
+    if (m_is_cacheable && m_source) image_cache::shared().store_async(m_filename, m_image, *m_source);
+    m_is_cacheable = false;
+    apply_residency();
+    return true;
+}
+
+auto texture::finish() -> void {
+    if (m_pending.valid()) m_pending.wait();
+    update();
+}
+
+auto texture::set_residency(residency const& policy) -> void {
+    finish();
+    if (policy == m_residency) return;
+    if (policy > m_residency) m_image = read_image();
+    m_residency = policy;
+    apply_residency();
+}
+
+auto texture::cpu_bytes() const -> usize {
+    return m_image ? held_bytes(*m_image, false) : 0;
+}
+
+auto texture::mapped_bytes() const -> usize {
+    return m_image ? held_bytes(*m_image, true) : 0;
+}
+
+auto texture::apply_residency() -> void {
+    if (!m_image || m_residency == residency::keep) return;
+    if (m_residency == residency::discard) {
+        m_image = nullptr;
+        return;
+    }
+    if (m_image->buffer()) m_image = make_proxy(*m_image);
+}
+
+auto texture::download() const -> ref<image> {
+    LUMA_PROFILE_SCOPE("texture::download");
+    // Compressed levels are decoded by the driver.
+    auto result = make_ref<image>(m_width, m_height, 4, m_type);
+    auto const type = m_type == pixel::type::u8 ? GL_UNSIGNED_BYTE
+                    : m_type == pixel::type::u16 ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT;
+    glBindTexture(GL_TEXTURE_2D, m_id);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, type, result->buffer());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return result;
+}
+
+auto texture::decode(std::string const& filename, bool const& mipmap, int32_t const& max_side) -> ref<image> {
+    auto result = image_cache::shared().get(filename, mipmap);
+    auto const size = resample::fit(result->width(), result->height(), max_side);
+    if (result->buffer() && (size.width != result->width() || size.height != result->height()))
+        result = shrink(*result, size, mipmap);
+    return result;
+}
+
+auto texture::set_max_size(int32_t const& size) -> void {
+    size_limit = std::max(size, 0);
+}
+
+auto texture::max_size() -> int32_t {
+    return size_limit;
 }
 
 auto texture::generate_mipmap() const -> void {
@@ -35,7 +267,6 @@ auto texture::generate_mipmap() const -> void {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glGenerateMipmap(GL_TEXTURE_2D);
 }
 
@@ -49,14 +280,92 @@ auto texture::unbind() const -> void {
 }
 
 auto texture::create_texture() -> uint32_t {
+    static constexpr uint32_t formats[4]{GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    static constexpr GLint    bytes[4]  {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    static constexpr GLint    shorts[4] {GL_R16, GL_RG16, GL_RGB16, GL_RGBA16};
+    static constexpr GLint    halves[4] {GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F};
+
     uint32_t id;
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    uint32_t format = m_image->channels() == 4 ? GL_RGBA : GL_RGB;
-    glTexImage2D(GL_TEXTURE_2D, 0, format, m_image->width(), m_image->height(), 0, format, GL_UNSIGNED_BYTE, m_image->buffer());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    auto const  channels = std::clamp(m_image->channels(), 1, 4);
+    auto const  source   = m_image->type();
+    auto const& mips     = m_image->mips();
+    m_type = pixel::is_float(source) ? pixel::type::f16 : source;
+
+    // Drivers pad RGB to RGBA.
+    auto const padded = usize(channels == 3 ? 4 : channels);
+    m_format    = formats[channels - 1];
+    m_internal  = bytes[channels - 1];
+    m_data_type = GL_UNSIGNED_BYTE;
+    m_texel     = padded;
+    if (m_type == pixel::type::u16) {
+        m_internal  = shorts[channels - 1];
+        m_data_type = GL_UNSIGNED_SHORT;
+        m_texel     = padded * 2;
+    } else if (m_type == pixel::type::f16) {
+        m_internal  = halves[channels - 1];
+        m_data_type = GL_HALF_FLOAT;
+        m_texel     = padded * 2;
+    }
+
+    std::vector<u16> staging;
+    auto const base = pixels_of(*m_image, staging);
+    // Opaque colour that is never negative fits 32 bits a texel, alpha is
+    // dropped from the RGBA data by the driver.
+    if (m_type == pixel::type::f16 && channels >= 3 && m_image->is_opaque() && base
+        && !pixel::has_negative(static_cast<u16 const*>(base),
+                                usize(m_image->width()) * usize(m_image->height()) * usize(channels))) {
+        m_internal = GL_R11F_G11F_B10F;
+        m_texel    = 4;
+    }
+    // Rows of anything but RGBA8 needn't be 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_internal, m_image->width(), m_image->height(), 0, m_format, m_data_type, base);
+    for (usize i = 0; i < mips.size(); i++)
+        glTexImage2D(GL_TEXTURE_2D, GLint(i + 1), m_internal, mips[i]->width(), mips[i]->height(), 0, m_format,
+                     m_data_type, pixels_of(*mips[i], staging));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(mips.size()));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mips.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (channels <= 2) {
+        // Gray, and gray with alpha.
+        GLint const swizzle[4]{GL_RED, GL_RED, GL_RED, channels == 2 ? GL_GREEN : GL_ONE};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_width     = m_image->buffer() ? m_image->width() : 0;
+    m_height    = m_image->buffer() ? m_image->height() : 0;
+    m_channels  = m_image->channels();
+    m_is_opaque = m_image->is_opaque();
+    m_gpu_bytes = usize(m_image->width()) * usize(m_image->height()) * m_texel;
+    for (auto const& mip : mips) m_gpu_bytes += usize(mip->width()) * usize(mip->height()) * m_texel;
+    return id;
+}
+
+auto texture::create_texture(bc::surface const& surface) -> uint32_t {
+    uint32_t id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    auto const format = bc::gl_format(surface.encoding);
+    for (usize i = 0; i < surface.levels.size(); i++) {
+        auto const& level = surface.levels[i];
+        glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), format, level.width, level.height, 0,
+                               GLsizei(level.data.size()), level.data.data());
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(surface.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, surface.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_width     = surface.levels[0].width;
+    m_height    = surface.levels[0].height;
+    m_channels  = surface.encoding == bc::format::bc1 ? 3 : 4;
+    m_is_opaque = surface.encoding == bc::format::bc1;
+    m_type      = pixel::type::u8;
+    m_gpu_bytes = surface.bytes();
     return id;
 }
 }
@@ -1,33 +1,120 @@
 #pragma once
 #include <cstdint>
+#include <future>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "luma.hpp"
 #include "image.hpp"
 #include "buffer.hpp"
+#include "bc.hpp"
+#include "image_cache.hpp"
 
 namespace luma {
 
+// What stays in system memory once the pixels are on the GPU. Ordered from
+// least to most held.
+enum class residency : uint8_t {
+    discard,    // nothing, read back on demand
+    proxy,      // a copy at most texture::PROXY_SIZE a side, for thumbnails and picking
+    keep,       // the full image and its mips
+};
+
 class texture {
   public:
-    texture(std::string const& filename, bool const& mipmap = true);
+    static constexpr int32_t PROXY_SIZE = 256;
+
+  public:
+    // A .ktx file is uploaded as is. Otherwise `compress` encodes to BC1/BC3
+    // when the driver has S3TC. The decoded image is then held as `policy` says.
+    // Uncompressed mips missing from the image_cache are filtered on the
+    // thread_pool, the texture samples its base until update() uploads them.
+    texture(std::string const& filename, bool const& mipmap = true, bool const& compress = false,
+            residency const& policy = residency::discard);
+    // Uploads an image from decode(), for files loaded off the GL thread.
+    texture(std::string const& filename, ref<image> const& decoded, bool const& mipmap = true,
+            residency const& policy = residency::discard);
+    // Render targets, the image is kept to be reused on resize.
     texture(int32_t const& width, int32_t const& height, int32_t const& channels = 4);
     ~texture();
 
+    // Uploads the mips once the thread_pool has them, true when it did.
+    // Cheap otherwise, call it every frame.
+    auto update() -> bool;
+    // Waits for the mips and uploads them.
+    auto finish() -> void;
+    auto is_pending() const -> bool { return m_pending.valid(); }
+
     auto framebuffer(ref<buffer::frame> const& framebuffer) -> void;
     auto resize(int32_t const& width, int32_t const& height) -> void;
+    // What the residency holds: the full image, the proxy or null.
     auto get_image() const -> ref<image> { return m_image; }
+    // Pixels at the texture's size, whatever the residency. The kept image,
+    // else the file again when its size and mtime are unchanged, from the
+    // image_cache or decoded without mips, else read back from GL, which
+    // needs the context. Not retained. Null when nothing was loaded.
+    auto read_image() const -> ref<image>;
+    auto get_residency() const -> residency { return m_residency; }
+    // Re-reads through read_image() when more is asked to be held.
+    auto set_residency(residency const& policy) -> void;
+    // Held in the heap, and in mappings of the image cache, which are clean
+    // file pages the kernel can drop.
+    auto cpu_bytes() const -> usize;
+    auto mapped_bytes() const -> usize;
+    auto width() const -> int32_t { return m_width; }
+    auto height() const -> int32_t { return m_height; }
+    auto channels() const -> int32_t { return m_channels; }
+    // As held by the GPU, f32 images are uploaded as halves. Float textures
+    // sample linear light, the others sRGB.
+    auto type() const -> pixel::type { return m_type; }
+    auto is_opaque() const -> bool { return m_is_opaque; }
+    auto gpu_bytes() const -> usize { return m_gpu_bytes; }
+    auto is_loaded() const -> bool { return m_width > 0 && m_height > 0; }
     auto id() const -> uint32_t { return m_id; }
     auto generate_mipmap() const -> void;
     auto bind(uint32_t const& id = 0) -> void;
     auto unbind() const -> void;
 
+    // Images with a longer side are filtered down to it on load, so a photo
+    // viewed on screen costs the screen's worth of memory. 0 leaves only
+    // GL_MAX_TEXTURE_SIZE. Textures already loaded, cached ones included,
+    // keep their size.
+    static auto set_max_size(int32_t const& size) -> void;
+    static auto max_size() -> int32_t;
+    // max_size() capped by GL_MAX_TEXTURE_SIZE, needs the context.
+    static auto upload_limit() -> int32_t;
+
+    // The CPU half of loading a file, safe on any thread. Mapped or decoded
+    // through the image_cache, then shrunk to `max_side`.
+    static auto decode(std::string const& filename, bool const& mipmap, int32_t const& max_side) -> ref<image>;
+
   private:
     auto create_texture() -> uint32_t;
+    auto create_texture(bc::surface const& surface) -> uint32_t;
+    auto apply_residency() -> void;
+    auto download() const -> ref<image>;
 
   private:
-    uint32_t   m_id;
-    ref<image> m_image;
+    uint32_t    m_id;
+    ref<image>  m_image;
+    std::string m_filename;
+    std::optional<image_cache::source> m_source;    // the file as it was loaded
+    bool        m_is_mipmapped = false;
+    residency   m_residency    = residency::keep;
+    int32_t     m_width        = 0;
+    int32_t     m_height       = 0;
+    int32_t     m_channels     = 0;
+    pixel::type m_type         = pixel::type::u8;
+    bool        m_is_opaque    = true;
+    usize       m_gpu_bytes    = 0;
+    // As create_texture() chose, for the levels update() adds.
+    int32_t     m_internal     = 0;
+    uint32_t    m_format       = 0;
+    uint32_t    m_data_type    = 0;
+    usize       m_texel        = 0;
+    std::future<std::vector<ref<image>>> m_pending;
+    bool        m_is_cacheable = false;
 };
 
 }
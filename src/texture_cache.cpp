@@ -0,0 +1,129 @@
+#include "texture_cache.hpp"
+#include "profile.hpp"
+
+#include <filesystem>
+
+namespace luma {
+
+auto texture_cache::key_hash::operator()(key const& key) const -> usize {
+    return std::hash<std::string>{}(key.path) ^ (usize(key.mipmap) << 1) ^ (usize(key.compress) << 2);
+}
+
+texture_cache::texture_cache() : m_budget() {}
+
+texture_cache::texture_cache(budget const& limits) : m_budget(limits) {}
+
+auto texture_cache::get(std::string const& filename, bool const& mipmap, bool const& compress,
+                        residency const& policy) -> ref<texture> {
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(filename, error);
+    key const k{error ? filename : canonical.string(), mipmap, compress};
+
+    std::lock_guard lock{m_mutex};
+    auto it = m_entries.find(k);
+    if (it != std::end(m_entries)) {
+        m_stats.hits++;
+        m_order.splice(std::begin(m_order), m_order, it->second.order);
+        auto value = it->second.value;
+        value->update();
+        if (policy > value->get_residency()) value->set_residency(policy);
+        account(it->second);
+        evict(m_budget);
+        return value;
+    }
+
+    LUMA_PROFILE_SCOPE("texture_cache::load");
+    m_stats.misses++;
+    auto loaded = make_ref<texture>(k.path, mipmap, compress, policy);
+    // Failed loads aren't cached, the file may show up later.
+    if (!loaded->is_loaded()) return loaded;
+
+    m_order.push_front(k);
+    auto& e = m_entries[k];
+    e = {loaded, std::begin(m_order), 0, 0, 0};
+    account(e);
+    evict(m_budget);
+    return loaded;
+}
+
+auto texture_cache::update() -> void {
+    std::lock_guard lock{m_mutex};
+    auto is_changed = false;
+    for (auto& [k, e] : m_entries) {
+        if (!e.value->update()) continue;
+        account(e);
+        is_changed = true;
+    }
+    if (is_changed) evict(m_budget);
+}
+
+auto texture_cache::set_budget(budget const& limits) -> void {
+    std::lock_guard lock{m_mutex};
+    m_budget = limits;
+    evict(m_budget);
+}
+
+auto texture_cache::get_budget() const -> budget {
+    std::lock_guard lock{m_mutex};
+    return m_budget;
+}
+
+auto texture_cache::trim() -> usize {
+    std::lock_guard lock{m_mutex};
+    return evict({0, 0});
+}
+
+auto texture_cache::clear() -> usize {
+    std::lock_guard lock{m_mutex};
+    auto const count = m_entries.size();
+    m_entries.clear();
+    m_order.clear();
+    m_stats.gpu_bytes    = 0;
+    m_stats.cpu_bytes    = 0;
+    m_stats.mapped_bytes = 0;
+    return count;
+}
+
+auto texture_cache::statistics() const -> stats {
+    std::lock_guard lock{m_mutex};
+    auto result = m_stats;
+    result.entries = m_entries.size();
+    return result;
+}
+
+auto texture_cache::account(entry& entry) -> void {
+    m_stats.gpu_bytes    += entry.value->gpu_bytes() - entry.gpu_bytes;
+    m_stats.cpu_bytes    += entry.value->cpu_bytes() - entry.cpu_bytes;
+    m_stats.mapped_bytes += entry.value->mapped_bytes() - entry.mapped_bytes;
+    entry.gpu_bytes    = entry.value->gpu_bytes();
+    entry.cpu_bytes    = entry.value->cpu_bytes();
+    entry.mapped_bytes = entry.value->mapped_bytes();
+}
+
+auto texture_cache::evict(budget const& limits) -> usize {
+    usize evicted = 0;
+    auto it = std::end(m_order);
+    while (it != std::begin(m_order)
+           && (m_stats.gpu_bytes > limits.gpu || m_stats.cpu_bytes > limits.cpu)) {
+        --it;
+        auto found = m_entries.find(*it);
+        // Someone still holds it, evicting would only drop the cache's share.
+        if (found->second.value.use_count() > 1) continue;
+
+        m_stats.gpu_bytes -= found->second.gpu_bytes;
+        m_stats.cpu_bytes -= found->second.cpu_bytes;
+        m_stats.mapped_bytes -= found->second.mapped_bytes;
+        m_entries.erase(found);
+        it = m_order.erase(it);
+        m_stats.evictions++;
+        evicted++;
+    }
+    return evicted;
+}
+
+auto texture_cache::shared() -> texture_cache& {
+    static texture_cache instance{};
+    return instance;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "luma.hpp"
+#include "texture.hpp"
+
+namespace luma {
+
+// Shares textures by canonical path and load options, so a file is decoded
+// and uploaded once however many times it is opened. The cache keeps a strong
+// reference to everything it has loaded and drops the least recently used
+// textures nobody else holds once the budget is exceeded. Textures still in
+// use are never evicted, they count against the budget until released.
+// Mapped bytes are reported but not budgeted, the kernel reclaims them.
+//
+// Loads upload to GL, use it from the thread owning the context.
+class texture_cache {
+  public:
+    struct key {
+        std::string path;       // canonical
+        bool        mipmap   = true;
+        bool        compress = false;
+
+        auto operator==(key const& other) const -> bool = default;
+    };
+
+    struct key_hash {
+        auto operator()(key const& key) const -> usize;
+    };
+
+    struct budget {
+        usize gpu = usize(512) << 20;
+        usize cpu = usize(512) << 20;
+    };
+
+    struct stats {
+        u64   hits;
+        u64   misses;
+        u64   evictions;
+        usize entries;
+        usize gpu_bytes;
+        usize cpu_bytes;
+        usize mapped_bytes;
+    };
+
+  public:
+    texture_cache();
+    explicit texture_cache(budget const& limits);
+    ~texture_cache() = default;
+
+    // A hit asking for more residency than the texture has raises it, a
+    // texture is never made to hold less than someone asked for.
+    auto get(std::string const& filename, bool const& mipmap = true, bool const& compress = false,
+             residency const& policy = residency::discard) -> ref<texture>;
+
+    // Uploads the mips finished in the background, once a frame.
+    auto update() -> void;
+
+    auto set_budget(budget const& limits) -> void;
+    auto get_budget() const -> budget;
+    // Evict every texture nobody else holds, returns how many were dropped.
+    auto trim() -> usize;
+    // Drop every texture, held or not. The shared cache is static, clear it
+    // while the context that owns the textures is still alive.
+    auto clear() -> usize;
+    auto statistics() const -> stats;
+
+    static auto shared() -> texture_cache&;
+
+  private:
+    struct entry {
+        ref<luma::texture>        value;
+        std::list<key>::iterator  order;
+        usize                     gpu_bytes;
+        usize                     cpu_bytes;
+        usize                     mapped_bytes;
+    };
+
+    // Re-reads the texture's bytes, its residency may have changed since.
+    auto account(entry& entry) -> void;
+    auto evict(budget const& limits) -> usize;
+
+  private:
+    mutable std::mutex m_mutex;
+    budget m_budget;
+    stats  m_stats{};
+    std::list<key> m_order;     // most recently used first
+    std::unordered_map<key, entry, key_hash> m_entries;
+};
+
+}
@@ -0,0 +1,91 @@
+#include "thread_pool.hpp"
+#include "profile.hpp"
+
+#include <atomic>
+#include <algorithm>
+
+namespace luma {
+
+thread_pool::thread_pool(usize const& count) {
+    auto const workers = std::max<usize>(count, 1);
+    m_workers.reserve(workers);
+    for (usize i = 0; i < workers; i++)
+        m_workers.emplace_back([this] { run(); });
+}
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard lock{m_mutex};
+        m_is_running = false;
+    }
+    m_condition.notify_all();
+    for (auto& worker : m_workers) worker.join();
+}
+
+auto thread_pool::push(job_fn const& job) -> void {
+    {
+        std::lock_guard lock{m_mutex};
+        m_jobs.push_back(job);
+    }
+    m_condition.notify_one();
+}
+
+auto thread_pool::run() -> void {
+    LUMA_PROFILE_THREAD("worker");
+    while (true) {
+        job_fn job;
+        {
+            std::unique_lock lock{m_mutex};
+            m_condition.wait(lock, [this] { return !m_is_running || !m_jobs.empty(); });
+            if (!m_is_running && m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+auto thread_pool::parallel_for(usize const& begin, usize const& end, range_fn const& fn, usize const& grain) -> void {
+    if (begin >= end) return;
+    auto const total  = end - begin;
+    auto const chunks = std::min(std::max<usize>(total / std::max<usize>(grain, 1), 1), size() * 4);
+    if (chunks == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    // Workers pull chunk indices until none are left. State is shared so a
+    // helper that starts after the caller has returned finds nothing to do.
+    struct state {
+        std::atomic<usize>      next{0};
+        std::atomic<usize>      done{0};
+        std::mutex              mutex;
+        std::condition_variable condition;
+    };
+    auto shared = std::make_shared<state>();
+    auto work = [=, &fn] {
+        usize chunk;
+        while ((chunk = shared->next.fetch_add(1)) < chunks) {
+            auto const first = begin + total * chunk / chunks;
+            auto const last  = begin + total * (chunk + 1) / chunks;
+            fn(first, last);
+            if (shared->done.fetch_add(1) + 1 == chunks) {
+                std::lock_guard lock{shared->mutex};
+                shared->condition.notify_all();
+            }
+        }
+    };
+
+    auto const helpers = std::min(size(), chunks - 1);
+    for (usize i = 0; i < helpers; i++) push(work);
+    work();
+
+    std::unique_lock lock{shared->mutex};
+    shared->condition.wait(lock, [&] { return shared->done.load() == chunks; });
+}
+
+auto thread_pool::shared() -> thread_pool& {
+    static thread_pool pool{};
+    return pool;
+}
+
+}
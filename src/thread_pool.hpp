@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+#include "luma.hpp"
+
+namespace luma {
+
+class thread_pool {
+  public:
+    using job_fn   = std::function<void()>;
+    using range_fn = std::function<void(usize const& begin, usize const& end)>;
+
+  public:
+    thread_pool(usize const& count = std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    auto size() const -> usize { return m_workers.size(); }
+
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+        using result_t = std::invoke_result_t<Fn>;
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<Fn>(fn));
+        auto future = task->get_future();
+        push([task] { (*task)(); });
+        return future;
+    }
+
+    // Split [begin, end) into chunks of at least grain elements and run them
+    // on the workers. The calling thread helps out, so nesting is safe.
+    auto parallel_for(usize const& begin, usize const& end, range_fn const& fn, usize const& grain = 1) -> void;
+
+    // Shared pool sized to the machine, created on first use.
+    static auto shared() -> thread_pool&;
+
+  private:
+    auto push(job_fn const& job) -> void;
+    auto run() -> void;
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::deque<job_fn>       m_jobs;
+    std::mutex               m_mutex;
+    std::condition_variable  m_condition;
+    bool                     m_is_running = true;
+};
+
+}
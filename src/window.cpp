@@ -1,5 +1,6 @@
 #include "window.hpp"
 #include "input.hpp"
+#include "profile.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -29,6 +30,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
 
     glfwSetWindowUserPointer(m_window, &m_data);
     glfwSetWindowSizeCallback(m_window, [](GLFWwindow* window, int32_t width, int32_t height) {
+        LUMA_PROFILE_SCOPE("window::on_resize");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
         data->width  = width;
         data->height = height;
@@ -43,6 +45,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
     });
     glfwSetFramebufferSizeCallback(m_window,
     [](GLFWwindow* window, int32_t width, int32_t height) {
+        LUMA_PROFILE_SCOPE("window::on_buffer_resize");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
         data->buffer_width  = width;
         data->buffer_height = height;
@@ -56,6 +59,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         });
     });
     glfwSetWindowPosCallback(m_window, [](GLFWwindow* window, int32_t xpos, int32_t ypos){
+        LUMA_PROFILE_SCOPE("window::on_move");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
         data->x = xpos;
         data->y = ypos;
@@ -69,6 +73,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         });
     });
     glfwSetWindowFocusCallback(m_window, [](GLFWwindow* window, int32_t focused) {
+        LUMA_PROFILE_SCOPE("window::on_focus");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
 
         auto it = data->events.find(event::type::window_focus);
@@ -80,6 +85,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         });
     });
     glfwSetCursorPosCallback(m_window, [](GLFWwindow* window, double xpos, double ypos) {
+        LUMA_PROFILE_SCOPE("window::on_mouse_move");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
 
         auto it = data->events.find(event::type::mouse_move);
@@ -91,6 +97,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         });
     });
     glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int32_t button, int32_t action, int32_t mods) {
+        LUMA_PROFILE_SCOPE("window::on_mouse_button");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
         double pos_x, pos_y;
         glfwGetCursorPos(window, &pos_x, &pos_y);
@@ -116,6 +123,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         }
     });
     glfwSetScrollCallback(m_window, [](GLFWwindow* window, double xoffset, double yoffset){
+        LUMA_PROFILE_SCOPE("window::on_scroll");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
 
         auto it = data->events.find(event::type::mouse_wheel);
@@ -127,6 +135,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         });
     });
     glfwSetKeyCallback(m_window, [](GLFWwindow* window, int32_t key, int32_t code, int32_t action, int32_t mods) {
+        LUMA_PROFILE_SCOPE("window::on_key");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
 
         if (action == GLFW_PRESS || action == GLFW_REPEAT) {
@@ -150,6 +159,7 @@ window::window(std::string const& name, int32_t const& width, int32_t const& hei
         }
     });
     glfwSetCharCallback(m_window, [](GLFWwindow* window, unsigned int codepoint) {
+        LUMA_PROFILE_SCOPE("window::on_char");
         auto data = static_cast<window::data*>(glfwGetWindowUserPointer(window));
         auto it = data->events.find(event::type::key_typed);
         if (it == data->events.end()) return;
@@ -169,12 +179,23 @@ window::~window() {
 
 auto window::swap() -> void { glfwSwapBuffers(m_window); }
 auto window::poll() -> void {
+    LUMA_PROFILE_FUNCTION();
     std::for_each(std::begin(m_data.keys), std::end(m_data.keys),
     [this](auto const& pair) {
         pair.second->update(this->get_key(pair.second->value));
     });
     glfwPollEvents();
 }
+auto window::wait(double const& timeout) -> void {
+    LUMA_PROFILE_FUNCTION();
+    std::for_each(std::begin(m_data.keys), std::end(m_data.keys),
+    [this](auto const& pair) {
+        pair.second->update(this->get_key(pair.second->value));
+    });
+    glfwWaitEventsTimeout(timeout);
+}
+auto window::make_current() -> void { glfwMakeContextCurrent(m_window); }
+auto window::release_current() -> void { glfwMakeContextCurrent(nullptr); }
 auto window::get_native() -> GLFWwindow* { return m_window; }
 auto window::should_close() -> bool { return glfwWindowShouldClose(m_window); }
 auto window::get_key(int32_t key) -> int32_t { return glfwGetKey(m_window, key); }
@@ -25,6 +25,10 @@ class window{
 
     auto swap() -> void;
     auto poll() -> void;
+    // Like poll() but sleeps until an event arrives or timeout seconds pass.
+    auto wait(double const& timeout) -> void;
+    auto make_current() -> void;
+    static auto release_current() -> void;
     auto get_native() -> GLFWwindow*;
     auto should_close() -> bool;
 